@@ -0,0 +1,200 @@
+// CppNumericalSolver
+#ifndef COMPLEXSTEP_H
+#define COMPLEXSTEP_H
+
+#include <cmath>
+#include <complex>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+#include <Eigen/Core>
+
+namespace cppoptlib {
+namespace autodiff {
+
+/**
+ * @brief complex number for complex-step differentiation
+ * @details f(x + ih) = f(x) + ih f'(x) + O(h^2) for a real analytic f, so Im f(x + ih) / h
+ *          is the derivative without any subtraction and h can be far below the machine
+ *          epsilon. The arithmetic is the one of std::complex. Unlike std::complex the
+ *          comparisons look at the real part and abs() is the analytic continuation
+ *          z * sign(Re z) instead of the modulus, so objectives and the library code of
+ *          Problem that compare or take absolute values work unchanged.
+ *
+ * @tparam T underlying real type
+ */
+template<typename T>
+class Complex {
+ public:
+  using Scalar = T;
+
+  std::complex<T> z;
+
+  Complex() : z(0) {}
+  Complex(const T &value) : z(value) {}
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  Complex(const U &value) : z(T(value)) {}
+  Complex(const T &re, const T &im) : z(re, im) {}
+  explicit Complex(const std::complex<T> &value) : z(value) {}
+
+  T real() const { return z.real(); }
+  T imag() const { return z.imag(); }
+
+  Complex &operator+=(const Complex &b) { z += b.z; return *this; }
+  Complex &operator-=(const Complex &b) { z -= b.z; return *this; }
+  Complex &operator*=(const Complex &b) { z *= b.z; return *this; }
+  Complex &operator/=(const Complex &b) { z /= b.z; return *this; }
+
+  friend Complex operator+(const Complex &a) { return a; }
+  friend Complex operator-(const Complex &a) { return Complex(-a.z); }
+
+  friend Complex operator+(const Complex &a, const Complex &b) { return Complex(a.z + b.z); }
+  friend Complex operator-(const Complex &a, const Complex &b) { return Complex(a.z - b.z); }
+  friend Complex operator*(const Complex &a, const Complex &b) { return Complex(a.z * b.z); }
+  friend Complex operator/(const Complex &a, const Complex &b) { return Complex(a.z / b.z); }
+
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Complex operator+(const Complex &a, const U &b) { return Complex(a.z + T(b)); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Complex operator+(const U &a, const Complex &b) { return Complex(T(a) + b.z); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Complex operator-(const Complex &a, const U &b) { return Complex(a.z - T(b)); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Complex operator-(const U &a, const Complex &b) { return Complex(T(a) - b.z); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Complex operator*(const Complex &a, const U &b) { return Complex(a.z * T(b)); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Complex operator*(const U &a, const Complex &b) { return Complex(T(a) * b.z); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Complex operator/(const Complex &a, const U &b) { return Complex(a.z / T(b)); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Complex operator/(const U &a, const Complex &b) { return Complex(T(a) / b.z); }
+
+  // comparisons only look at the real part
+  friend bool operator<(const Complex &a, const Complex &b) { return a.real() < b.real(); }
+  friend bool operator>(const Complex &a, const Complex &b) { return a.real() > b.real(); }
+  friend bool operator<=(const Complex &a, const Complex &b) { return a.real() <= b.real(); }
+  friend bool operator>=(const Complex &a, const Complex &b) { return a.real() >= b.real(); }
+  friend bool operator==(const Complex &a, const Complex &b) { return a.real() == b.real(); }
+  friend bool operator!=(const Complex &a, const Complex &b) { return a.real() != b.real(); }
+
+  friend std::ostream &operator<<(std::ostream &os, const Complex &a) { return os << a.z; }
+};
+
+#define CPPOPTLIB_COMPLEX_UNARY(name)                  \
+  template<typename T>                                 \
+  inline Complex<T> name(const Complex<T> &a) {        \
+    return Complex<T>(std::name(a.z));                 \
+  }
+
+CPPOPTLIB_COMPLEX_UNARY(sqrt)
+CPPOPTLIB_COMPLEX_UNARY(exp)
+CPPOPTLIB_COMPLEX_UNARY(log)
+CPPOPTLIB_COMPLEX_UNARY(log10)
+CPPOPTLIB_COMPLEX_UNARY(sin)
+CPPOPTLIB_COMPLEX_UNARY(cos)
+CPPOPTLIB_COMPLEX_UNARY(tan)
+CPPOPTLIB_COMPLEX_UNARY(sinh)
+CPPOPTLIB_COMPLEX_UNARY(cosh)
+CPPOPTLIB_COMPLEX_UNARY(tanh)
+CPPOPTLIB_COMPLEX_UNARY(asin)
+CPPOPTLIB_COMPLEX_UNARY(acos)
+CPPOPTLIB_COMPLEX_UNARY(atan)
+
+#undef CPPOPTLIB_COMPLEX_UNARY
+
+// real cube root continued along the real axis, std::pow would take the principal branch
+template<typename T>
+inline Complex<T> cbrt(const Complex<T> &a) {
+  const std::complex<T> r = std::pow((a.real() < T(0)) ? -a.z : a.z, T(1) / T(3));
+  return Complex<T>((a.real() < T(0)) ? -r : r);
+}
+template<typename T>
+inline Complex<T> abs(const Complex<T> &a) { return (a.real() < T(0)) ? -a : a; }
+template<typename T>
+inline Complex<T> fabs(const Complex<T> &a) { return (a.real() < T(0)) ? -a : a; }
+template<typename T>
+inline Complex<T> abs2(const Complex<T> &a) { return a * a; }
+
+template<typename T, typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+inline Complex<T> pow(const Complex<T> &a, const U &b) { return Complex<T>(std::pow(a.z, T(b))); }
+template<typename T, typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+inline Complex<T> pow(const U &a, const Complex<T> &b) { return Complex<T>(std::pow(T(a), b.z)); }
+template<typename T>
+inline Complex<T> pow(const Complex<T> &a, const Complex<T> &b) { return Complex<T>(std::pow(a.z, b.z)); }
+
+// the imaginary parts are tiny, so the first order expansion is exact
+template<typename T>
+inline Complex<T> atan2(const Complex<T> &y, const Complex<T> &x) {
+  using std::atan2;
+  const T inv = T(1) / (x.real() * x.real() + y.real() * y.real());
+  return Complex<T>(atan2(y.real(), x.real()), (x.real() * y.imag() - y.real() * x.imag()) * inv);
+}
+
+template<typename T>
+inline bool isfinite(const Complex<T> &a) { using std::isfinite; return isfinite(a.real()); }
+template<typename T>
+inline bool isnan(const Complex<T> &a) { using std::isnan; return isnan(a.real()); }
+template<typename T>
+inline bool isinf(const Complex<T> &a) { using std::isinf; return isinf(a.real()); }
+
+} // end namespace autodiff
+
+using autodiff::Complex;
+
+} // end namespace cppoptlib
+
+namespace std {
+
+template<typename T>
+class numeric_limits<cppoptlib::autodiff::Complex<T>> : public numeric_limits<T> {
+ public:
+  using C = cppoptlib::autodiff::Complex<T>;
+  static C epsilon() { return C(numeric_limits<T>::epsilon()); }
+  static C min() { return C(numeric_limits<T>::min()); }
+  static C max() { return C(numeric_limits<T>::max()); }
+  static C lowest() { return C(numeric_limits<T>::lowest()); }
+  static C infinity() { return C(numeric_limits<T>::infinity()); }
+  static C quiet_NaN() { return C(numeric_limits<T>::quiet_NaN()); }
+};
+
+} // end namespace std
+
+namespace Eigen {
+
+// not complex for Eigen: conjugation and the modulus would break analyticity
+template<typename T>
+struct NumTraits<cppoptlib::autodiff::Complex<T>> : NumTraits<T> {
+  typedef cppoptlib::autodiff::Complex<T> Real;
+  typedef cppoptlib::autodiff::Complex<T> NonInteger;
+  typedef cppoptlib::autodiff::Complex<T> Nested;
+  typedef cppoptlib::autodiff::Complex<T> Literal;
+  enum {
+    IsComplex = 0,
+    IsInteger = 0,
+    IsSigned = 1,
+    RequireInitialization = 1,
+    ReadCost = 2 * NumTraits<T>::ReadCost,
+    AddCost = 2 * NumTraits<T>::AddCost,
+    MulCost = 4 * NumTraits<T>::MulCost + 2 * NumTraits<T>::AddCost
+  };
+  static inline Real epsilon() { return Real(NumTraits<T>::epsilon()); }
+  static inline Real dummy_precision() { return Real(NumTraits<T>::dummy_precision()); }
+  static inline Real highest() { return Real(NumTraits<T>::highest()); }
+  static inline Real lowest() { return Real(NumTraits<T>::lowest()); }
+  static inline Real infinity() { return Real(NumTraits<T>::infinity()); }
+  static inline Real quiet_NaN() { return Real(NumTraits<T>::quiet_NaN()); }
+};
+
+template<typename T, typename BinaryOp>
+struct ScalarBinaryOpTraits<cppoptlib::autodiff::Complex<T>, T, BinaryOp> {
+  typedef cppoptlib::autodiff::Complex<T> ReturnType;
+};
+template<typename T, typename BinaryOp>
+struct ScalarBinaryOpTraits<T, cppoptlib::autodiff::Complex<T>, BinaryOp> {
+  typedef cppoptlib::autodiff::Complex<T> ReturnType;
+};
+
+} // end namespace Eigen
+
+#endif // COMPLEXSTEP_H
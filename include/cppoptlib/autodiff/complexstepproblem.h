@@ -0,0 +1,93 @@
+// CppNumericalSolver
+#ifndef COMPLEXSTEPPROBLEM_H
+#define COMPLEXSTEPPROBLEM_H
+
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <Eigen/Core>
+
+#include "../problem.h"
+#include "complexstep.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief gradient of a templated problem by complex-step differentiation
+ * @details ComplexStepProblem<Rosenbrock, double> is a Rosenbrock<double> whose gradient
+ *          is Im f(x + i h e_j) / h, evaluated on Rosenbrock<Complex<double>>. Since nothing
+ *          is subtracted the step h = eps^2 leaves the derivative correct to machine
+ *          precision. A gradient costs D evaluations, which are spread over
+ *          setNumThreads() copies of the problem. Both instances are constructed from the
+ *          same arguments, the objective has to be real analytic in each coordinate.
+ *
+ * @tparam ProblemTemplate problem templated on its scalar type
+ * @tparam Scalar_ scalar type of the problem seen by the solver
+ */
+template<template<typename> class ProblemTemplate, typename Scalar_>
+class ComplexStepProblem : public ProblemTemplate<Scalar_> {
+ public:
+  using Superclass = ProblemTemplate<Scalar_>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using typename Superclass::TIndex;
+  using TComplex = Complex<Scalar>;
+  using TComplexProblem = ProblemTemplate<TComplex>;
+
+ protected:
+  TComplexProblem m_complexProblem;
+  typename TComplexProblem::TVector m_xComplex;
+
+ public:
+  template<typename... Args>
+  explicit ComplexStepProblem(const Args &... args) :
+    Superclass(args...),
+    m_complexProblem(args...)
+  {}
+
+  TComplexProblem &complexProblem() { return m_complexProblem; }
+
+  std::unique_ptr<Problem<Scalar, Superclass::Dim>> clone() const {
+    return std::unique_ptr<Problem<Scalar, Superclass::Dim>>(new ComplexStepProblem(*this));
+  }
+
+  bool hasAnalyticGradient() const {
+    return true;
+  }
+
+  void gradient(const TVector &x, TVector &grad) {
+    valueAndGradient(x, grad);
+  }
+
+  Scalar valueAndGradient(const TVector &x, TVector &grad) {
+    const TIndex D = x.rows();
+    const Scalar h = std::numeric_limits<Scalar>::epsilon() * std::numeric_limits<Scalar>::epsilon();
+    grad.resize(D);
+
+    const int threads = static_cast<int>(std::min<TIndex>(this->m_threads, std::max<TIndex>(D, 1)));
+    std::vector<std::unique_ptr<Problem<Scalar, Superclass::Dim>>> owned;
+    const std::vector<Problem<Scalar, Superclass::Dim> *> problems = this->threadProblems(threads, owned);
+    for (int t = 0; t < threads; ++t) {
+      ComplexStepProblem *problem = static_cast<ComplexStepProblem *>(problems[t]);
+      problem->m_xComplex.resize(D);
+      for (TIndex i = 0; i < D; ++i)
+        problem->m_xComplex[i] = TComplex(x[i]);
+    }
+
+    std::vector<Scalar> values(threads, Scalar(0));
+    parallelFor(0, D, threads, [&](int t, TIndex j) {
+      ComplexStepProblem *problem = static_cast<ComplexStepProblem *>(problems[t]);
+      problem->m_xComplex[j] = TComplex(x[j], h);
+      const TComplex f = problem->m_complexProblem.value(problem->m_xComplex);
+      problem->m_xComplex[j] = TComplex(x[j]);
+      grad[j] = f.imag() / h;
+      values[t] = f.real();
+    });
+    return (D > 0) ? values[0] : this->value(x);
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // COMPLEXSTEPPROBLEM_H
@@ -0,0 +1,234 @@
+// CppNumericalSolver
+#ifndef DUAL_H
+#define DUAL_H
+
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+#include <Eigen/Core>
+
+namespace cppoptlib {
+// math functions for the derivative types live in their own namespace, they are found
+// by argument dependent lookup and do not hide ::fabs & co. inside cppoptlib
+namespace autodiff {
+
+/**
+ * @brief dual number for forward-mode automatic differentiation
+ * @details carries a value and N directional derivatives (lanes). The lanes are
+ *          stored in a fixed-size Eigen array, so the derivative updates of every
+ *          operation are vectorised. T can itself be a Dual, which gives second
+ *          derivatives (forward over forward).
+ *
+ * @tparam T underlying scalar type
+ * @tparam N number of directional derivatives propagated at once
+ */
+template<typename T, int N>
+class Dual {
+ public:
+  using Scalar = T;
+  using TTangent = Eigen::Array<T, N, 1>;
+  static const int Lanes = N;
+
+  T v;         //!< value
+  TTangent d;  //!< directional derivatives
+
+  Dual() : v(0), d(TTangent::Zero()) {}
+  Dual(const T &value) : v(value), d(TTangent::Zero()) {}
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  Dual(const U &value) : v(T(value)), d(TTangent::Zero()) {}
+  Dual(const T &value, const TTangent &tangent) : v(value), d(tangent) {}
+
+  /**
+   * @brief a variable, its derivative is one in the given lane
+   */
+  static Dual variable(const T &value, int lane) {
+    Dual x(value);
+    x.d[lane] = T(1);
+    return x;
+  }
+
+  Dual &operator+=(const Dual &b) { v += b.v; d += b.d; return *this; }
+  Dual &operator-=(const Dual &b) { v -= b.v; d -= b.d; return *this; }
+  Dual &operator*=(const Dual &b) { d = d * b.v + v * b.d; v *= b.v; return *this; }
+  Dual &operator/=(const Dual &b) { const T inv = T(1) / b.v; v *= inv; d = (d - v * b.d) * inv; return *this; }
+
+  friend Dual operator+(const Dual &a) { return a; }
+  friend Dual operator-(const Dual &a) { return Dual(-a.v, -a.d); }
+
+  friend Dual operator+(const Dual &a, const Dual &b) { return Dual(a.v + b.v, a.d + b.d); }
+  friend Dual operator-(const Dual &a, const Dual &b) { return Dual(a.v - b.v, a.d - b.d); }
+  friend Dual operator*(const Dual &a, const Dual &b) { return Dual(a.v * b.v, a.d * b.v + a.v * b.d); }
+  friend Dual operator/(const Dual &a, const Dual &b) {
+    const T inv = T(1) / b.v;
+    const T value = a.v * inv;
+    return Dual(value, (a.d - value * b.d) * inv);
+  }
+
+  // mixed operations with plain numbers do not touch the zero lanes of a constant
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Dual operator+(const Dual &a, const U &b) { return Dual(a.v + T(b), a.d); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Dual operator+(const U &a, const Dual &b) { return Dual(T(a) + b.v, b.d); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Dual operator-(const Dual &a, const U &b) { return Dual(a.v - T(b), a.d); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Dual operator-(const U &a, const Dual &b) { return Dual(T(a) - b.v, -b.d); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Dual operator*(const Dual &a, const U &b) { return Dual(a.v * T(b), a.d * T(b)); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Dual operator*(const U &a, const Dual &b) { return Dual(T(a) * b.v, T(a) * b.d); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Dual operator/(const Dual &a, const U &b) { const T inv = T(1) / T(b); return Dual(a.v * inv, a.d * inv); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Dual operator/(const U &a, const Dual &b) { return Dual(a) / b; }
+
+  // comparisons only look at the value
+  friend bool operator<(const Dual &a, const Dual &b) { return a.v < b.v; }
+  friend bool operator>(const Dual &a, const Dual &b) { return a.v > b.v; }
+  friend bool operator<=(const Dual &a, const Dual &b) { return a.v <= b.v; }
+  friend bool operator>=(const Dual &a, const Dual &b) { return a.v >= b.v; }
+  friend bool operator==(const Dual &a, const Dual &b) { return a.v == b.v; }
+  friend bool operator!=(const Dual &a, const Dual &b) { return a.v != b.v; }
+
+  friend std::ostream &operator<<(std::ostream &os, const Dual &a) {
+    return os << a.v << " [" << a.d.transpose() << "]";
+  }
+};
+
+/**
+ * @brief value of a (possibly nested) dual number as plain scalar
+ */
+template<typename T>
+inline T dualValue(const T &a) { return a; }
+template<typename T, int N>
+inline auto dualValue(const Dual<T, N> &a) -> decltype(dualValue(a.v)) { return dualValue(a.v); }
+
+// chain rule: f(a) = f(a.v) + f'(a.v) * a.d
+#define CPPOPTLIB_DUAL_UNARY(name, value_expr, derivative_expr) \
+  template<typename T, int N>                                     \
+  inline Dual<T, N> name(const Dual<T, N> &a) {                   \
+    using std::sqrt; using std::exp; using std::log;              \
+    using std::sin; using std::cos; using std::tan;               \
+    using std::sinh; using std::cosh; using std::tanh;            \
+    using std::asin; using std::acos; using std::atan;            \
+    using std::cbrt;                                              \
+    const T value = value_expr;                                   \
+    return Dual<T, N>(value, (derivative_expr) * a.d);            \
+  }
+
+CPPOPTLIB_DUAL_UNARY(sqrt, sqrt(a.v), T(0.5) / value)
+CPPOPTLIB_DUAL_UNARY(cbrt, cbrt(a.v), T(1) / (T(3) * value * value))
+CPPOPTLIB_DUAL_UNARY(exp, exp(a.v), value)
+CPPOPTLIB_DUAL_UNARY(log, log(a.v), T(1) / a.v)
+CPPOPTLIB_DUAL_UNARY(log10, log(a.v) / log(T(10)), T(1) / (a.v * log(T(10))))
+CPPOPTLIB_DUAL_UNARY(sin, sin(a.v), cos(a.v))
+CPPOPTLIB_DUAL_UNARY(cos, cos(a.v), -sin(a.v))
+CPPOPTLIB_DUAL_UNARY(tan, tan(a.v), T(1) + value * value)
+CPPOPTLIB_DUAL_UNARY(sinh, sinh(a.v), cosh(a.v))
+CPPOPTLIB_DUAL_UNARY(cosh, cosh(a.v), sinh(a.v))
+CPPOPTLIB_DUAL_UNARY(tanh, tanh(a.v), T(1) - value * value)
+CPPOPTLIB_DUAL_UNARY(asin, asin(a.v), T(1) / sqrt(T(1) - a.v * a.v))
+CPPOPTLIB_DUAL_UNARY(acos, acos(a.v), T(-1) / sqrt(T(1) - a.v * a.v))
+CPPOPTLIB_DUAL_UNARY(atan, atan(a.v), T(1) / (T(1) + a.v * a.v))
+
+#undef CPPOPTLIB_DUAL_UNARY
+
+template<typename T, int N>
+inline Dual<T, N> abs(const Dual<T, N> &a) { return (a.v < T(0)) ? -a : a; }
+template<typename T, int N>
+inline Dual<T, N> fabs(const Dual<T, N> &a) { return abs(a); }
+template<typename T, int N>
+inline Dual<T, N> abs2(const Dual<T, N> &a) { return a * a; }
+
+template<typename T, int N, typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+inline Dual<T, N> pow(const Dual<T, N> &a, const U &b) {
+  using std::pow;
+  const T value = pow(a.v, T(b));
+  return Dual<T, N>(value, (T(b) * pow(a.v, T(b) - T(1))) * a.d);
+}
+template<typename T, int N, typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+inline Dual<T, N> pow(const U &a, const Dual<T, N> &b) {
+  using std::pow;
+  using std::log;
+  const T value = pow(T(a), b.v);
+  return Dual<T, N>(value, (value * log(T(a))) * b.d);
+}
+template<typename T, int N>
+inline Dual<T, N> pow(const Dual<T, N> &a, const Dual<T, N> &b) {
+  return exp(b * log(a));
+}
+template<typename T, int N>
+inline Dual<T, N> atan2(const Dual<T, N> &y, const Dual<T, N> &x) {
+  using std::atan2;
+  const T inv = T(1) / (x.v * x.v + y.v * y.v);
+  return Dual<T, N>(atan2(y.v, x.v), (x.v * inv) * y.d - (y.v * inv) * x.d);
+}
+
+template<typename T, int N>
+inline bool isfinite(const Dual<T, N> &a) { using std::isfinite; return isfinite(a.v) && a.d.isFinite().all(); }
+template<typename T, int N>
+inline bool isnan(const Dual<T, N> &a) { using std::isnan; return isnan(a.v) || a.d.isNaN().any(); }
+template<typename T, int N>
+inline bool isinf(const Dual<T, N> &a) { using std::isinf; return isinf(a.v) || a.d.isInf().any(); }
+
+} // end namespace autodiff
+
+using autodiff::Dual;
+
+} // end namespace cppoptlib
+
+namespace std {
+
+template<typename T, int N>
+class numeric_limits<cppoptlib::autodiff::Dual<T, N>> : public numeric_limits<T> {
+ public:
+  using D = cppoptlib::autodiff::Dual<T, N>;
+  static D epsilon() { return D(numeric_limits<T>::epsilon()); }
+  static D min() { return D(numeric_limits<T>::min()); }
+  static D max() { return D(numeric_limits<T>::max()); }
+  static D lowest() { return D(numeric_limits<T>::lowest()); }
+  static D infinity() { return D(numeric_limits<T>::infinity()); }
+  static D quiet_NaN() { return D(numeric_limits<T>::quiet_NaN()); }
+};
+
+} // end namespace std
+
+namespace Eigen {
+
+template<typename T, int N>
+struct NumTraits<cppoptlib::autodiff::Dual<T, N>> : NumTraits<T> {
+  typedef cppoptlib::autodiff::Dual<T, N> Real;
+  typedef cppoptlib::autodiff::Dual<T, N> NonInteger;
+  typedef cppoptlib::autodiff::Dual<T, N> Nested;
+  typedef cppoptlib::autodiff::Dual<T, N> Literal;
+  enum {
+    IsComplex = 0,
+    IsInteger = 0,
+    IsSigned = 1,
+    RequireInitialization = 1,
+    ReadCost = (N + 1) * NumTraits<T>::ReadCost,
+    AddCost = (N + 1) * NumTraits<T>::AddCost,
+    MulCost = (2 * N + 1) * NumTraits<T>::MulCost
+  };
+  static inline Real epsilon() { return Real(NumTraits<T>::epsilon()); }
+  static inline Real dummy_precision() { return Real(NumTraits<T>::dummy_precision()); }
+  static inline Real highest() { return Real(NumTraits<T>::highest()); }
+  static inline Real lowest() { return Real(NumTraits<T>::lowest()); }
+  static inline Real infinity() { return Real(NumTraits<T>::infinity()); }
+  static inline Real quiet_NaN() { return Real(NumTraits<T>::quiet_NaN()); }
+};
+
+// allow expressions mixing dual numbers and plain scalars, e.g. x.array() * 2.0
+template<typename T, int N, typename BinaryOp>
+struct ScalarBinaryOpTraits<cppoptlib::autodiff::Dual<T, N>, T, BinaryOp> {
+  typedef cppoptlib::autodiff::Dual<T, N> ReturnType;
+};
+template<typename T, int N, typename BinaryOp>
+struct ScalarBinaryOpTraits<T, cppoptlib::autodiff::Dual<T, N>, BinaryOp> {
+  typedef cppoptlib::autodiff::Dual<T, N> ReturnType;
+};
+
+} // end namespace Eigen
+
+#endif // DUAL_H
@@ -0,0 +1,92 @@
+// CppNumericalSolver
+#ifndef FORWARDDIFFLEASTSQUARESPROBLEM_H
+#define FORWARDDIFFLEASTSQUARESPROBLEM_H
+
+#include <algorithm>
+#include <memory>
+#include <Eigen/Core>
+
+#include "../leastsquaresproblem.h"
+#include "dual.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief exact jacobian of templated residuals by forward-mode automatic differentiation
+ * @details ForwardDiffLeastSquaresProblem<Fit, double> is a Fit<double> whose jacobian is
+ *          computed by evaluating Fit<Dual<...>>::residuals, Lanes columns per evaluation.
+ *          Both instances are constructed from the same arguments, data changed after
+ *          construction has to be changed on both.
+ *
+ * @tparam ProblemTemplate least squares problem templated on its scalar type
+ * @tparam Scalar_ scalar type of the problem seen by the solver
+ * @tparam Lanes number of jacobian columns propagated per evaluation
+ */
+template<template<typename> class ProblemTemplate, typename Scalar_, int Lanes = 4>
+class ForwardDiffLeastSquaresProblem : public ProblemTemplate<Scalar_> {
+ public:
+  using Superclass = ProblemTemplate<Scalar_>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using typename Superclass::TIndex;
+  using typename Superclass::TResiduals;
+  using typename Superclass::TJacobian;
+  using TDual = Dual<Scalar, Lanes>;
+  using TDualProblem = ProblemTemplate<TDual>;
+
+ protected:
+  TDualProblem m_dualProblem;
+  typename TDualProblem::TVector m_xDual;
+  typename TDualProblem::TResiduals m_rDual;
+
+ public:
+  template<typename... Args>
+  explicit ForwardDiffLeastSquaresProblem(const Args &... args) :
+    Superclass(args...),
+    m_dualProblem(args...)
+  {}
+
+  TDualProblem &dualProblem() { return m_dualProblem; }
+
+  std::unique_ptr<Problem<Scalar, Superclass::Dim>> clone() const {
+    return std::unique_ptr<Problem<Scalar, Superclass::Dim>>(new ForwardDiffLeastSquaresProblem(*this));
+  }
+
+  bool hasAnalyticGradient() const {
+    return true;
+  }
+
+  void jacobian(const TVector &x, TJacobian &J) {
+    TResiduals r;
+    residualsAndJacobian(x, r, J);
+  }
+
+  void residualsAndJacobian(const TVector &x, TResiduals &r, TJacobian &J) {
+    const TIndex D = x.rows();
+    m_xDual.resize(D);
+    for (TIndex i = 0; i < D; ++i)
+      m_xDual[i] = TDual(x[i]);
+
+    for (TIndex j0 = 0; j0 < std::max<TIndex>(D, 1); j0 += Lanes) {
+      const int lanes = static_cast<int>(std::min<TIndex>(Lanes, D - j0));
+      for (int l = 0; l < lanes; ++l)
+        m_xDual[j0 + l].d[l] = 1;
+      m_dualProblem.residuals(m_xDual, m_rDual);
+      if (j0 == 0) {
+        r.resize(m_rDual.rows());
+        J.resize(m_rDual.rows(), D);
+        for (TIndex i = 0; i < m_rDual.rows(); ++i)
+          r[i] = m_rDual[i].v;
+      }
+      for (int l = 0; l < lanes; ++l) {
+        for (TIndex i = 0; i < m_rDual.rows(); ++i)
+          J(i, j0 + l) = m_rDual[i].d[l];
+        m_xDual[j0 + l].d[l] = 0;
+      }
+    }
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // FORWARDDIFFLEASTSQUARESPROBLEM_H
@@ -0,0 +1,156 @@
+// CppNumericalSolver
+#ifndef FORWARDDIFFPROBLEM_H
+#define FORWARDDIFFPROBLEM_H
+
+#include <algorithm>
+#include <memory>
+#include <Eigen/Core>
+
+#include "../problem.h"
+#include "dual.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief exact derivatives of a templated problem by forward-mode automatic differentiation
+ * @details ForwardDiffProblem<Rosenbrock, double> is a Rosenbrock<double> whose gradient
+ *          and hessian are computed by evaluating Rosenbrock<Dual<...>>::value. A gradient
+ *          costs ceil(D / Lanes) evaluations on dual numbers and a hessian
+ *          ceil(D / Lanes) * (ceil(D / Lanes) + 1) / 2 evaluations on nested dual numbers,
+ *          without any step size. All three instances are constructed from the same
+ *          arguments, so the problem template has to accept them for every scalar type.
+ *          Data changed after construction has to be changed on all instances.
+ *
+ * @tparam ProblemTemplate problem templated on its scalar type
+ * @tparam Scalar_ scalar type of the problem seen by the solver
+ * @tparam Lanes number of derivatives propagated per evaluation
+ */
+template<template<typename> class ProblemTemplate, typename Scalar_, int Lanes = 4>
+class ForwardDiffProblem : public ProblemTemplate<Scalar_> {
+ public:
+  using Superclass = ProblemTemplate<Scalar_>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using typename Superclass::THessian;
+  using typename Superclass::TIndex;
+  using TDual = Dual<Scalar, Lanes>;
+  using TDual2 = Dual<TDual, Lanes>;
+  using TDualProblem = ProblemTemplate<TDual>;
+  using TDual2Problem = ProblemTemplate<TDual2>;
+
+ protected:
+  TDualProblem m_dualProblem;
+  TDual2Problem m_dual2Problem;
+  typename TDualProblem::TVector m_xDual;
+  typename TDual2Problem::TVector m_xDual2;
+
+ public:
+  template<typename... Args>
+  explicit ForwardDiffProblem(const Args &... args) :
+    Superclass(args...),
+    m_dualProblem(args...),
+    m_dual2Problem(args...)
+  {}
+
+  TDualProblem &dualProblem() { return m_dualProblem; }
+  TDual2Problem &dual2Problem() { return m_dual2Problem; }
+
+  std::unique_ptr<Problem<Scalar, Superclass::Dim>> clone() const {
+    return std::unique_ptr<Problem<Scalar, Superclass::Dim>>(new ForwardDiffProblem(*this));
+  }
+
+  bool hasAnalyticGradient() const {
+    return true;
+  }
+
+  void gradient(const TVector &x, TVector &grad) {
+    valueAndGradient(x, grad);
+  }
+
+  Scalar valueAndGradient(const TVector &x, TVector &grad) {
+    const TIndex D = x.rows();
+    grad.resize(D);
+    m_xDual.resize(D);
+    for (TIndex i = 0; i < D; ++i)
+      m_xDual[i] = TDual(x[i]);
+
+    Scalar f = 0;
+    for (TIndex j0 = 0; j0 < std::max<TIndex>(D, 1); j0 += Lanes) {
+      const int lanes = static_cast<int>(std::min<TIndex>(Lanes, D - j0));
+      for (int l = 0; l < lanes; ++l)
+        m_xDual[j0 + l].d[l] = 1;
+      const TDual fd = m_dualProblem.value(m_xDual);
+      for (int l = 0; l < lanes; ++l) {
+        grad[j0 + l] = fd.d[l];
+        m_xDual[j0 + l].d[l] = 0;
+      }
+      f = fd.v;
+    }
+    return f;
+  }
+
+  /**
+   * @brief exact hessian-vector product
+   * @details the inner lane 0 carries the direction v and the outer lanes seed blocks
+   *          of coordinates, so ceil(D / Lanes) evaluations on nested dual numbers suffice
+   */
+  void hessianVectorProduct(const TVector &x, const TVector &v, TVector &Hv) {
+    const TIndex D = x.rows();
+    Hv.resize(D);
+    m_xDual2.resize(D);
+    for (TIndex i = 0; i < D; ++i) {
+      m_xDual2[i] = TDual2(TDual(x[i]));
+      m_xDual2[i].v.d[0] = v[i];
+    }
+
+    for (TIndex r0 = 0; r0 < D; r0 += Lanes) {
+      const int rows = static_cast<int>(std::min<TIndex>(Lanes, D - r0));
+      for (int k = 0; k < rows; ++k)
+        m_xDual2[r0 + k].d[k].v = 1;
+      const TDual2 f = m_dual2Problem.value(m_xDual2);
+      for (int k = 0; k < rows; ++k) {
+        Hv[r0 + k] = f.d[k].d[0];
+        m_xDual2[r0 + k].d[k].v = 0;
+      }
+    }
+  }
+
+  /**
+   * @brief exact hessian, computed in blocks of Lanes x Lanes entries
+   * @details the inner lanes seed the columns and the outer lanes the rows of a block,
+   *          only blocks on or above the diagonal are evaluated
+   */
+  void hessian(const TVector &x, THessian &hessian) {
+    const TIndex D = x.rows();
+    hessian.resize(D, D);
+    m_xDual2.resize(D);
+    for (TIndex i = 0; i < D; ++i)
+      m_xDual2[i] = TDual2(TDual(x[i]));
+
+    for (TIndex r0 = 0; r0 < D; r0 += Lanes) {
+      const int rows = static_cast<int>(std::min<TIndex>(Lanes, D - r0));
+      for (int k = 0; k < rows; ++k)
+        m_xDual2[r0 + k].d[k].v = 1;
+      for (TIndex c0 = r0; c0 < D; c0 += Lanes) {
+        const int cols = static_cast<int>(std::min<TIndex>(Lanes, D - c0));
+        for (int l = 0; l < cols; ++l)
+          m_xDual2[c0 + l].v.d[l] = 1;
+        const TDual2 f = m_dual2Problem.value(m_xDual2);
+        for (int k = 0; k < rows; ++k) {
+          for (int l = 0; l < cols; ++l) {
+            hessian(r0 + k, c0 + l) = f.d[k].d[l];
+            hessian(c0 + l, r0 + k) = f.d[k].d[l];
+          }
+        }
+        for (int l = 0; l < cols; ++l)
+          m_xDual2[c0 + l].v.d[l] = 0;
+      }
+      for (int k = 0; k < rows; ++k)
+        m_xDual2[r0 + k].d[k].v = 0;
+    }
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // FORWARDDIFFPROBLEM_H
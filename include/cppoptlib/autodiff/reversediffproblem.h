@@ -0,0 +1,83 @@
+// CppNumericalSolver
+#ifndef REVERSEDIFFPROBLEM_H
+#define REVERSEDIFFPROBLEM_H
+
+#include <memory>
+#include <vector>
+#include <Eigen/Core>
+
+#include "../problem.h"
+#include "tape.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief exact gradient of a templated problem by reverse-mode automatic differentiation
+ * @details ReverseDiffProblem<Rosenbrock, double> is a Rosenbrock<double> whose gradient is
+ *          computed by recording one evaluation of Rosenbrock<Var<double>>::value on a tape
+ *          and sweeping it backwards once. The cost does not depend on the number of
+ *          variables, which makes it the better choice than ForwardDiffProblem for large D.
+ *          The tape is kept between calls, so once it has grown to the size of one
+ *          evaluation computing a gradient does not allocate any more. Both instances are
+ *          constructed from the same arguments.
+ *
+ * @tparam ProblemTemplate problem templated on its scalar type
+ * @tparam Scalar_ scalar type of the problem seen by the solver
+ */
+template<template<typename> class ProblemTemplate, typename Scalar_>
+class ReverseDiffProblem : public ProblemTemplate<Scalar_> {
+ public:
+  using Superclass = ProblemTemplate<Scalar_>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using typename Superclass::TIndex;
+  using TVar = Var<Scalar>;
+  using TVarProblem = ProblemTemplate<TVar>;
+
+ protected:
+  TVarProblem m_varProblem;
+  Tape<Scalar> m_tape;
+  typename TVarProblem::TVector m_xVar;
+
+ public:
+  template<typename... Args>
+  explicit ReverseDiffProblem(const Args &... args) :
+    Superclass(args...),
+    m_varProblem(args...)
+  {}
+
+  TVarProblem &varProblem() { return m_varProblem; }
+  const Tape<Scalar> &tape() const { return m_tape; }
+
+  std::unique_ptr<Problem<Scalar, Superclass::Dim>> clone() const {
+    return std::unique_ptr<Problem<Scalar, Superclass::Dim>>(new ReverseDiffProblem(*this));
+  }
+
+  bool hasAnalyticGradient() const {
+    return true;
+  }
+
+  void gradient(const TVector &x, TVector &grad) {
+    valueAndGradient(x, grad);
+  }
+
+  Scalar valueAndGradient(const TVector &x, TVector &grad) {
+    const TIndex D = x.rows();
+    TapeScope<Scalar> scope(m_tape);
+    m_tape.clear();
+    m_xVar.resize(D);
+    for (TIndex i = 0; i < D; ++i)
+      m_xVar[i] = TVar::variable(x[i]);
+
+    const TVar f = m_varProblem.value(m_xVar);
+    const std::vector<Scalar> &adjoints = m_tape.adjoints(f.i);
+    grad.resize(D);
+    for (TIndex i = 0; i < D; ++i)
+      grad[i] = adjoints[m_xVar[i].i];
+    return f.v;
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // REVERSEDIFFPROBLEM_H
@@ -0,0 +1,336 @@
+// CppNumericalSolver
+#ifndef TAPE_H
+#define TAPE_H
+
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <ostream>
+#include <type_traits>
+#include <vector>
+#include <Eigen/Core>
+
+namespace cppoptlib {
+namespace autodiff {
+
+/**
+ * @brief recording of an evaluation for reverse-mode automatic differentiation
+ * @details every operation on Var appends one node holding the indices of (at most two)
+ *          operands and the partial derivatives with respect to them. The nodes live in
+ *          a vector that is cleared but never shrunk, so after the first evaluation
+ *          recording does not allocate any more. One backward sweep over the nodes gives
+ *          the derivatives of one output with respect to all inputs.
+ *
+ *          Operations record onto the active tape of the current thread, see TapeScope.
+ */
+template<typename T>
+class Tape {
+ public:
+  using Index = Eigen::DenseIndex;
+
+ protected:
+  struct Node {
+    Index parent[2];
+    T partial[2];
+  };
+  std::vector<Node> m_nodes;
+  std::vector<T> m_adjoints;
+
+ public:
+  static Tape *&active() {
+    static thread_local Tape *tape = nullptr;
+    return tape;
+  }
+
+  /**
+   * @brief forgets all nodes but keeps the memory
+   */
+  void clear() { m_nodes.clear(); }
+  void reserve(Index nodes) { m_nodes.reserve(nodes); }
+  Index size() const { return m_nodes.size(); }
+  Index capacity() const { return m_nodes.capacity(); }
+
+  /**
+   * @brief appends a node, operands with index -1 are constants and are left out
+   * @return index of the new node, or -1 if all operands were constants
+   */
+  Index push(Index p0, const T &d0, Index p1 = -1, const T &d1 = T(0)) {
+    if ((p0 < 0) && (p1 < 0))
+      return -1;
+    Node n;
+    n.parent[0] = p0;
+    n.partial[0] = d0;
+    n.parent[1] = p1;
+    n.partial[1] = d1;
+    m_nodes.push_back(n);
+    return m_nodes.size() - 1;
+  }
+
+  /**
+   * @brief appends an independent variable
+   */
+  Index variable() {
+    Node n;
+    n.parent[0] = n.parent[1] = -1;
+    n.partial[0] = n.partial[1] = T(0);
+    m_nodes.push_back(n);
+    return m_nodes.size() - 1;
+  }
+
+  /**
+   * @brief backward sweep
+   * @return derivatives of node `output` with respect to every node, in particular the
+   *         variables recorded first
+   */
+  const std::vector<T> &adjoints(Index output) {
+    m_adjoints.assign(m_nodes.size(), T(0));
+    if (output < 0)
+      return m_adjoints;
+    m_adjoints[output] = T(1);
+    for (Index k = output; k >= 0; --k) {
+      const T a = m_adjoints[k];
+      if (a == T(0))
+        continue;
+      const Node &n = m_nodes[k];
+      if (n.parent[0] >= 0)
+        m_adjoints[n.parent[0]] += a * n.partial[0];
+      if (n.parent[1] >= 0)
+        m_adjoints[n.parent[1]] += a * n.partial[1];
+    }
+    return m_adjoints;
+  }
+};
+
+/**
+ * @brief makes a tape the active tape of this thread for its lifetime
+ */
+template<typename T>
+class TapeScope {
+  Tape<T> *m_previous;
+
+ public:
+  explicit TapeScope(Tape<T> &tape) : m_previous(Tape<T>::active()) { Tape<T>::active() = &tape; }
+  ~TapeScope() { Tape<T>::active() = m_previous; }
+  TapeScope(const TapeScope &) = delete;
+  TapeScope &operator=(const TapeScope &) = delete;
+};
+
+/**
+ * @brief scalar recorded on the active tape for reverse-mode automatic differentiation
+ * @details a Var is a value and the index of its node on the tape, constants have index -1
+ *          and never touch the tape
+ */
+template<typename T>
+class Var {
+ public:
+  using Scalar = T;
+  using Index = Eigen::DenseIndex;
+
+  T v;      //!< value
+  Index i;  //!< node on the active tape, -1 for constants
+
+  Var() : v(0), i(-1) {}
+  Var(const T &value) : v(value), i(-1) {}
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  Var(const U &value) : v(T(value)), i(-1) {}
+  Var(const T &value, Index index) : v(value), i(index) {}
+
+  /**
+   * @brief a new independent variable on the active tape
+   */
+  static Var variable(const T &value) {
+    assert(Tape<T>::active() != nullptr);
+    return Var(value, Tape<T>::active()->variable());
+  }
+
+  /**
+   * @brief result of a unary operation with derivative d
+   */
+  static Var unary(const T &value, const Var &a, const T &d) {
+    return (a.i < 0) ? Var(value) : Var(value, Tape<T>::active()->push(a.i, d));
+  }
+
+  /**
+   * @brief result of a binary operation with partial derivatives da and db
+   */
+  static Var binary(const T &value, const Var &a, const T &da, const Var &b, const T &db) {
+    if ((a.i < 0) && (b.i < 0))
+      return Var(value);
+    return Var(value, Tape<T>::active()->push(a.i, da, b.i, db));
+  }
+
+  Var &operator+=(const Var &b) { return *this = *this + b; }
+  Var &operator-=(const Var &b) { return *this = *this - b; }
+  Var &operator*=(const Var &b) { return *this = *this * b; }
+  Var &operator/=(const Var &b) { return *this = *this / b; }
+
+  friend Var operator+(const Var &a) { return a; }
+  friend Var operator-(const Var &a) { return unary(-a.v, a, T(-1)); }
+
+  friend Var operator+(const Var &a, const Var &b) { return binary(a.v + b.v, a, T(1), b, T(1)); }
+  friend Var operator-(const Var &a, const Var &b) { return binary(a.v - b.v, a, T(1), b, T(-1)); }
+  friend Var operator*(const Var &a, const Var &b) { return binary(a.v * b.v, a, b.v, b, a.v); }
+  friend Var operator/(const Var &a, const Var &b) {
+    const T inv = T(1) / b.v;
+    const T value = a.v * inv;
+    return binary(value, a, inv, b, -value * inv);
+  }
+
+  // adding a constant does not change any derivative, so it does not need a node
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Var operator+(const Var &a, const U &b) { return Var(a.v + T(b), a.i); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Var operator+(const U &a, const Var &b) { return Var(T(a) + b.v, b.i); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Var operator-(const Var &a, const U &b) { return Var(a.v - T(b), a.i); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Var operator-(const U &a, const Var &b) { return unary(T(a) - b.v, b, T(-1)); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Var operator*(const Var &a, const U &b) { return unary(a.v * T(b), a, T(b)); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Var operator*(const U &a, const Var &b) { return unary(T(a) * b.v, b, T(a)); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Var operator/(const Var &a, const U &b) { return unary(a.v / T(b), a, T(1) / T(b)); }
+  template<typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+  friend Var operator/(const U &a, const Var &b) {
+    const T value = T(a) / b.v;
+    return unary(value, b, -value / b.v);
+  }
+
+  // comparisons only look at the value
+  friend bool operator<(const Var &a, const Var &b) { return a.v < b.v; }
+  friend bool operator>(const Var &a, const Var &b) { return a.v > b.v; }
+  friend bool operator<=(const Var &a, const Var &b) { return a.v <= b.v; }
+  friend bool operator>=(const Var &a, const Var &b) { return a.v >= b.v; }
+  friend bool operator==(const Var &a, const Var &b) { return a.v == b.v; }
+  friend bool operator!=(const Var &a, const Var &b) { return a.v != b.v; }
+
+  friend std::ostream &operator<<(std::ostream &os, const Var &a) { return os << a.v; }
+};
+
+#define CPPOPTLIB_VAR_UNARY(name, value_expr, derivative_expr) \
+  template<typename T>                                           \
+  inline Var<T> name(const Var<T> &a) {                          \
+    using std::sqrt; using std::exp; using std::log;             \
+    using std::sin; using std::cos; using std::tan;              \
+    using std::sinh; using std::cosh; using std::tanh;           \
+    using std::asin; using std::acos; using std::atan;           \
+    using std::cbrt;                                             \
+    const T value = value_expr;                                  \
+    return Var<T>::unary(value, a, derivative_expr);             \
+  }
+
+CPPOPTLIB_VAR_UNARY(sqrt, sqrt(a.v), T(0.5) / value)
+CPPOPTLIB_VAR_UNARY(cbrt, cbrt(a.v), T(1) / (T(3) * value * value))
+CPPOPTLIB_VAR_UNARY(exp, exp(a.v), value)
+CPPOPTLIB_VAR_UNARY(log, log(a.v), T(1) / a.v)
+CPPOPTLIB_VAR_UNARY(log10, log(a.v) / log(T(10)), T(1) / (a.v * log(T(10))))
+CPPOPTLIB_VAR_UNARY(sin, sin(a.v), cos(a.v))
+CPPOPTLIB_VAR_UNARY(cos, cos(a.v), -sin(a.v))
+CPPOPTLIB_VAR_UNARY(tan, tan(a.v), T(1) + value * value)
+CPPOPTLIB_VAR_UNARY(sinh, sinh(a.v), cosh(a.v))
+CPPOPTLIB_VAR_UNARY(cosh, cosh(a.v), sinh(a.v))
+CPPOPTLIB_VAR_UNARY(tanh, tanh(a.v), T(1) - value * value)
+CPPOPTLIB_VAR_UNARY(asin, asin(a.v), T(1) / sqrt(T(1) - a.v * a.v))
+CPPOPTLIB_VAR_UNARY(acos, acos(a.v), T(-1) / sqrt(T(1) - a.v * a.v))
+CPPOPTLIB_VAR_UNARY(atan, atan(a.v), T(1) / (T(1) + a.v * a.v))
+CPPOPTLIB_VAR_UNARY(abs, (a.v < T(0)) ? -a.v : a.v, (a.v < T(0)) ? T(-1) : T(1))
+CPPOPTLIB_VAR_UNARY(fabs, (a.v < T(0)) ? -a.v : a.v, (a.v < T(0)) ? T(-1) : T(1))
+CPPOPTLIB_VAR_UNARY(abs2, a.v * a.v, T(2) * a.v)
+
+#undef CPPOPTLIB_VAR_UNARY
+
+template<typename T, typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+inline Var<T> pow(const Var<T> &a, const U &b) {
+  using std::pow;
+  return Var<T>::unary(pow(a.v, T(b)), a, T(b) * pow(a.v, T(b) - T(1)));
+}
+template<typename T, typename U, typename std::enable_if<std::is_arithmetic<U>::value, int>::type = 0>
+inline Var<T> pow(const U &a, const Var<T> &b) {
+  using std::pow;
+  using std::log;
+  const T value = pow(T(a), b.v);
+  return Var<T>::unary(value, b, value * log(T(a)));
+}
+template<typename T>
+inline Var<T> pow(const Var<T> &a, const Var<T> &b) {
+  using std::pow;
+  using std::log;
+  const T value = pow(a.v, b.v);
+  return Var<T>::binary(value, a, b.v * pow(a.v, b.v - T(1)), b, value * log(a.v));
+}
+template<typename T>
+inline Var<T> atan2(const Var<T> &y, const Var<T> &x) {
+  using std::atan2;
+  const T inv = T(1) / (x.v * x.v + y.v * y.v);
+  return Var<T>::binary(atan2(y.v, x.v), y, x.v * inv, x, -y.v * inv);
+}
+
+template<typename T>
+inline bool isfinite(const Var<T> &a) { using std::isfinite; return isfinite(a.v); }
+template<typename T>
+inline bool isnan(const Var<T> &a) { using std::isnan; return isnan(a.v); }
+template<typename T>
+inline bool isinf(const Var<T> &a) { using std::isinf; return isinf(a.v); }
+
+} // end namespace autodiff
+
+using autodiff::Tape;
+using autodiff::TapeScope;
+using autodiff::Var;
+
+} // end namespace cppoptlib
+
+namespace std {
+
+template<typename T>
+class numeric_limits<cppoptlib::autodiff::Var<T>> : public numeric_limits<T> {
+ public:
+  using V = cppoptlib::autodiff::Var<T>;
+  static V epsilon() { return V(numeric_limits<T>::epsilon()); }
+  static V min() { return V(numeric_limits<T>::min()); }
+  static V max() { return V(numeric_limits<T>::max()); }
+  static V lowest() { return V(numeric_limits<T>::lowest()); }
+  static V infinity() { return V(numeric_limits<T>::infinity()); }
+  static V quiet_NaN() { return V(numeric_limits<T>::quiet_NaN()); }
+};
+
+} // end namespace std
+
+namespace Eigen {
+
+template<typename T>
+struct NumTraits<cppoptlib::autodiff::Var<T>> : NumTraits<T> {
+  typedef cppoptlib::autodiff::Var<T> Real;
+  typedef cppoptlib::autodiff::Var<T> NonInteger;
+  typedef cppoptlib::autodiff::Var<T> Nested;
+  typedef cppoptlib::autodiff::Var<T> Literal;
+  enum {
+    IsComplex = 0,
+    IsInteger = 0,
+    IsSigned = 1,
+    RequireInitialization = 1,
+    ReadCost = 2 * NumTraits<T>::ReadCost,
+    AddCost = 4 * NumTraits<T>::AddCost,
+    MulCost = 4 * NumTraits<T>::MulCost
+  };
+  static inline Real epsilon() { return Real(NumTraits<T>::epsilon()); }
+  static inline Real dummy_precision() { return Real(NumTraits<T>::dummy_precision()); }
+  static inline Real highest() { return Real(NumTraits<T>::highest()); }
+  static inline Real lowest() { return Real(NumTraits<T>::lowest()); }
+  static inline Real infinity() { return Real(NumTraits<T>::infinity()); }
+  static inline Real quiet_NaN() { return Real(NumTraits<T>::quiet_NaN()); }
+};
+
+template<typename T, typename BinaryOp>
+struct ScalarBinaryOpTraits<cppoptlib::autodiff::Var<T>, T, BinaryOp> {
+  typedef cppoptlib::autodiff::Var<T> ReturnType;
+};
+template<typename T, typename BinaryOp>
+struct ScalarBinaryOpTraits<T, cppoptlib::autodiff::Var<T>, BinaryOp> {
+  typedef cppoptlib::autodiff::Var<T> ReturnType;
+};
+
+} // end namespace Eigen
+
+#endif // TAPE_H
@@ -0,0 +1,171 @@
+// CppNumericalSolver
+#ifndef CACHEDPROBLEM_H
+#define CACHEDPROBLEM_H
+
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <Eigen/Core>
+
+#include "problem.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief memoizes the most recent evaluations of a problem
+ * @details wraps any problem and remembers value, gradient and hessian of the
+ *          last few points (least recently used are dropped first). Points are
+ *          compared by their exact bits, so a solver re-evaluating the point it
+ *          just got from the line search does not touch the objective again.
+ *          The wrapped problem must outlive the cache.
+ *
+ * @tparam ProblemType problem to wrap
+ */
+template<typename ProblemType>
+class CachedProblem : public Problem<typename ProblemType::Scalar, ProblemType::Dim> {
+ public:
+  using Superclass = Problem<typename ProblemType::Scalar, ProblemType::Dim>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using typename Superclass::THessian;
+  using typename Superclass::TCriteria;
+  using typename Superclass::TBatch;
+  using typename Superclass::TBatchValues;
+
+ protected:
+  struct Entry {
+    TVector x;
+    bool hasValue = false;
+    bool hasGradient = false;
+    bool hasHessian = false;
+    Scalar value;
+    TVector gradient;
+    THessian hessian;
+  };
+
+  ProblemType &m_problem;
+  // most recently used entry first
+  std::list<Entry> m_entries;
+  size_t m_capacity;
+  size_t m_hits = 0;
+  size_t m_misses = 0;
+
+  /**
+   * @brief returns the entry of x, creating it if x has not been seen recently
+   */
+  Entry &lookup(const TVector &x) {
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+      if ((it->x.rows() == x.rows()) &&
+          (std::memcmp(it->x.data(), x.data(), x.rows() * sizeof(Scalar)) == 0)) {
+        m_entries.splice(m_entries.begin(), m_entries, it);
+        return m_entries.front();
+      }
+    }
+    if (m_entries.size() >= m_capacity)
+      m_entries.pop_back();
+    m_entries.emplace_front();
+    m_entries.front().x = x;
+    return m_entries.front();
+  }
+
+ public:
+  explicit CachedProblem(ProblemType &problem, size_t capacity = 4) :
+    Superclass(),
+    m_problem(problem),
+    m_capacity(std::max(capacity, size_t(1)))
+  {}
+
+  ProblemType &problem() { return m_problem; }
+  size_t hits() const { return m_hits; }
+  size_t misses() const { return m_misses; }
+
+  void resetCounters() {
+    m_hits = 0;
+    m_misses = 0;
+  }
+
+  void clear() { m_entries.clear(); }
+
+  bool callback(const TCriteria &state, const TVector &x) {
+    return m_problem.callback(state, x);
+  }
+
+  Scalar value(const TVector &x) {
+    Entry &e = lookup(x);
+    if (e.hasValue) {
+      ++m_hits;
+    } else {
+      ++m_misses;
+      e.value = m_problem.value(x);
+      e.hasValue = true;
+    }
+    return e.value;
+  }
+
+  bool hasAnalyticGradient() const {
+    return m_problem.hasAnalyticGradient();
+  }
+
+  void gradient(const TVector &x, TVector &grad) {
+    Entry &e = lookup(x);
+    if (e.hasGradient) {
+      ++m_hits;
+    } else {
+      ++m_misses;
+      m_problem.gradient(x, e.gradient);
+      e.hasGradient = true;
+    }
+    grad = e.gradient;
+  }
+
+  Scalar valueAndGradient(const TVector &x, TVector &grad) {
+    Entry &e = lookup(x);
+    if (e.hasValue && e.hasGradient) {
+      ++m_hits;
+    } else {
+      ++m_misses;
+      if (e.hasValue) {
+        m_problem.gradient(x, e.gradient);
+      } else if (e.hasGradient) {
+        e.value = m_problem.value(x);
+      } else {
+        e.value = m_problem.valueAndGradient(x, e.gradient);
+      }
+      e.hasValue = true;
+      e.hasGradient = true;
+    }
+    grad = e.gradient;
+    return e.value;
+  }
+
+  void hessian(const TVector &x, THessian &hessian) {
+    Entry &e = lookup(x);
+    if (e.hasHessian) {
+      ++m_hits;
+    } else {
+      ++m_misses;
+      e.hessian.resize(x.rows(), x.rows());
+      m_problem.hessian(x, e.hessian);
+      e.hasHessian = true;
+    }
+    hessian = e.hessian;
+  }
+
+  // batches go to the wrapped problem in one piece, they are not cached
+  void valueBatch(const TBatch &X, TBatchValues &f) {
+    m_problem.valueBatch(X, f);
+  }
+
+  // products depend on v as well, they are passed through uncached
+  void hessianVectorProduct(const TVector &x, const TVector &v, TVector &Hv) {
+    m_problem.hessianVectorProduct(x, v, Hv);
+  }
+
+  // box constraints of the wrapped problem (only instantiated for bounded problems)
+  const TVector &lowerBound() const { return m_problem.lowerBound(); }
+  const TVector &upperBound() const { return m_problem.upperBound(); }
+};
+
+} // end namespace cppoptlib
+
+#endif // CACHEDPROBLEM_H
@@ -0,0 +1,54 @@
+// CppNumericalSolver
+#ifndef COLOURING_H
+#define COLOURING_H
+
+#include <algorithm>
+#include <vector>
+#include <Eigen/Core>
+
+namespace cppoptlib {
+
+/**
+ * @brief greedy column colouring of a sparse matrix (Curtis-Powell-Reid)
+ * @details two columns get different colours whenever they have a nonzero in the
+ *          same row. All columns of one colour can therefore be perturbed at once
+ *          and every nonzero read off directly from a single difference.
+ *
+ * @param columns row indices of the nonzeros in each column
+ * @param rows number of rows
+ * @param colours receives the colour of each column, numbered from 0
+ * @return number of colours used
+ */
+inline int colourColumns(const std::vector<std::vector<Eigen::DenseIndex>> &columns, Eigen::DenseIndex rows,
+                         std::vector<int> &colours) {
+  const Eigen::DenseIndex n = columns.size();
+  // columns touching each row
+  std::vector<std::vector<Eigen::DenseIndex>> rowColumns(rows);
+  for (Eigen::DenseIndex j = 0; j < n; ++j) {
+    for (Eigen::DenseIndex i : columns[j])
+      rowColumns[i].push_back(j);
+  }
+
+  colours.assign(n, -1);
+  // forbidden[c] == j marks colour c as taken by a neighbour of column j
+  std::vector<Eigen::DenseIndex> forbidden(n + 1, -1);
+  int numColours = 0;
+  for (Eigen::DenseIndex j = 0; j < n; ++j) {
+    for (Eigen::DenseIndex i : columns[j]) {
+      for (Eigen::DenseIndex k : rowColumns[i]) {
+        if (colours[k] >= 0)
+          forbidden[colours[k]] = j;
+      }
+    }
+    int c = 0;
+    while (forbidden[c] == j)
+      ++c;
+    colours[j] = c;
+    numColours = std::max(numColours, c + 1);
+  }
+  return numColours;
+}
+
+} // end namespace cppoptlib
+
+#endif // COLOURING_H
@@ -0,0 +1,238 @@
+// CppNumericalSolver
+#ifndef CONSTRAINEDPROBLEM_H
+#define CONSTRAINEDPROBLEM_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+#include "boundedproblem.h"
+#include "colouring.h"
+#include "parallel.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief problem with nonlinear equality and inequality constraints besides box bounds
+ * @details all constraints are returned as one vector c(x) by constraints(). The first
+ *          numEqualities() entries have to vanish, c_i(x) = 0, the remaining
+ *          numInequalities() entries have to be nonpositive, c_i(x) <= 0. The jacobian
+ *          of c falls back to central differences. If its sparsity has been declared
+ *          with setConstraintJacobianSparsity(), structurally independent columns are
+ *          perturbed together and one difference per colour suffices.
+ *          evaluate() returns objective, gradient, constraints and jacobian at once and
+ *          should be overwritten if they share work. Finite differences run on
+ *          numThreads() threads, clone() must then return a problem of the same type.
+ */
+template<typename Scalar_, int Dim_ = Eigen::Dynamic>
+class ConstrainedProblem : public BoundedProblem<Scalar_, Dim_> {
+ public:
+  using Superclass = BoundedProblem<Scalar_, Dim_>;
+  using TProblem = Problem<Scalar_, Dim_>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using TIndex = typename TVector::Index;
+  using TConstraints = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+  using TJacobian = Eigen::Matrix<Scalar, Eigen::Dynamic, Dim_>;
+  using TSparseJacobian = Eigen::SparseMatrix<Scalar>;
+
+ protected:
+  TIndex m_numEqualities = 0;
+  TIndex m_numInequalities = 0;
+  // rows of the nonzeros in each column of the constraint jacobian
+  std::vector<std::vector<TIndex>> m_jacobianPattern;
+  std::vector<int> m_jacobianColours;
+  int m_numJacobianColours = 0;
+
+  TVector steps(const TVector &x) const {
+    using std::abs;
+    using std::cbrt;
+    const Scalar eps = cbrt(std::numeric_limits<Scalar>::epsilon());
+    TVector h(x.rows());
+    for (TIndex j = 0; j < x.rows(); ++j)
+      h[j] = eps * std::max(abs(x[j]), Scalar(1.));
+    return h;
+  }
+
+  // central differences of the constraints, perturbing all columns of a group together
+  template<typename Store>
+  void finiteConstraintDifferences(const TVector &x, const std::vector<std::vector<TIndex>> &groups, Store store) {
+    const TVector h = steps(x);
+    const int threads = static_cast<int>(std::min<TIndex>(this->m_threads, std::max<TIndex>(groups.size(), 1)));
+    std::vector<std::unique_ptr<TProblem>> owned;
+    const std::vector<TProblem *> problems = this->threadProblems(threads, owned);
+    std::vector<TVector, Eigen::aligned_allocator<TVector>> xx(threads, x);
+    std::vector<TConstraints> plus(threads), minus(threads);
+    parallelFor(0, groups.size(), threads, [&](int t, TIndex g) {
+      // all clones of a constrained problem are constrained problems
+      ConstrainedProblem *problem = static_cast<ConstrainedProblem *>(problems[t]);
+      for (TIndex j : groups[g])
+        xx[t][j] = x[j] + h[j];
+      problem->constraints(xx[t], plus[t]);
+      for (TIndex j : groups[g])
+        xx[t][j] = x[j] - h[j];
+      problem->constraints(xx[t], minus[t]);
+      for (TIndex j : groups[g]) {
+        xx[t][j] = x[j];
+        store(j, (plus[t] - minus[t]) / (2 * h[j]));
+      }
+    });
+  }
+
+ public:
+  ConstrainedProblem(int RunDim = Dim_) : Superclass(RunDim) {}
+
+  ConstrainedProblem(const TVector &l, const TVector &u) : Superclass(l, u) {}
+
+  /**
+   * @brief declares the number of constraints returned by constraints()
+   */
+  void setNumConstraints(TIndex equalities, TIndex inequalities) {
+    m_numEqualities = equalities;
+    m_numInequalities = inequalities;
+  }
+
+  TIndex numEqualities() const { return m_numEqualities; }
+  TIndex numInequalities() const { return m_numInequalities; }
+  TIndex numConstraints() const { return m_numEqualities + m_numInequalities; }
+
+  /**
+   * @brief equalities followed by inequalities in x
+   */
+  virtual void constraints(const TVector &x, TConstraints &c) = 0;
+
+  /**
+   * @brief jacobian of constraints(), one row per constraint
+   * @details should be overwritten by a symbolic jacobian
+   */
+  virtual void constraintJacobian(const TVector &x, TJacobian &J) {
+    if (hasConstraintJacobianSparsity()) {
+      TSparseJacobian sparse;
+      finiteSparseConstraintJacobian(x, sparse);
+      J = sparse.toDense();
+    } else {
+      finiteConstraintJacobian(x, J);
+    }
+  }
+
+  /**
+   * @brief jacobian of constraints() as sparse matrix
+   * @details should be overwritten by a symbolic jacobian, uses the declared sparsity
+   *          for finite differences
+   */
+  virtual void sparseConstraintJacobian(const TVector &x, TSparseJacobian &J) {
+    if (hasConstraintJacobianSparsity()) {
+      finiteSparseConstraintJacobian(x, J);
+    } else {
+      TJacobian dense;
+      constraintJacobian(x, dense);
+      J = dense.sparseView();
+    }
+  }
+
+  /**
+   * @brief objective value and constraints in x
+   */
+  virtual Scalar valueAndConstraints(const TVector &x, TConstraints &c) {
+    constraints(x, c);
+    return this->value(x);
+  }
+
+  /**
+   * @brief objective, gradient, constraints and their jacobian in x
+   * @details should be overwritten if they share work
+   */
+  virtual Scalar evaluate(const TVector &x, TVector &grad, TConstraints &c, TJacobian &J) {
+    constraints(x, c);
+    constraintJacobian(x, J);
+    return this->valueAndGradient(x, grad);
+  }
+
+  /**
+   * @brief evaluate() with a sparse jacobian
+   */
+  virtual Scalar evaluateSparse(const TVector &x, TVector &grad, TConstraints &c, TSparseJacobian &J) {
+    constraints(x, c);
+    sparseConstraintJacobian(x, J);
+    return this->valueAndGradient(x, grad);
+  }
+
+  /**
+   * @brief largest violation max(|c_eq|, max(c_ineq, 0)) of the constraints c
+   * @details box bounds are not included
+   */
+  Scalar constraintViolation(const TConstraints &c) const {
+    Scalar violation = 0;
+    if (m_numEqualities > 0)
+      violation = c.head(m_numEqualities).template lpNorm<Eigen::Infinity>();
+    if (m_numInequalities > 0)
+      violation = std::max(violation, c.tail(m_numInequalities).maxCoeff());
+    return violation;
+  }
+
+  /**
+   * @brief declares which entries of the constraint jacobian can be nonzero
+   * @details only the structure of pattern is used
+   */
+  void setConstraintJacobianSparsity(const TSparseJacobian &pattern) {
+    const TIndex D = pattern.cols();
+    m_jacobianPattern.assign(D, std::vector<TIndex>());
+    for (TIndex k = 0; k < pattern.outerSize(); ++k) {
+      for (typename TSparseJacobian::InnerIterator it(pattern, k); it; ++it)
+        m_jacobianPattern[it.col()].push_back(it.row());
+    }
+    for (auto &rows : m_jacobianPattern) {
+      std::sort(rows.begin(), rows.end());
+      rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    }
+    m_numJacobianColours = colourColumns(m_jacobianPattern, pattern.rows(), m_jacobianColours);
+  }
+
+  bool hasConstraintJacobianSparsity() const { return !m_jacobianPattern.empty(); }
+  int numConstraintJacobianColours() const { return m_numJacobianColours; }
+
+  /**
+   * @brief dense central differences of the constraints, 2 D evaluations
+   */
+  void finiteConstraintJacobian(const TVector &x, TJacobian &J) {
+    const TIndex D = x.rows();
+    std::vector<std::vector<TIndex>> groups(D);
+    for (TIndex j = 0; j < D; ++j)
+      groups[j].push_back(j);
+    J.resize(numConstraints(), D);
+    finiteConstraintDifferences(x, groups, [&](TIndex j, const TConstraints &diff) {
+      J.col(j) = diff;
+    });
+  }
+
+  /**
+   * @brief sparse central differences of the constraints, 2 evaluations per colour
+   */
+  void finiteSparseConstraintJacobian(const TVector &x, TSparseJacobian &J) {
+    const TIndex D = x.rows();
+    std::vector<std::vector<TIndex>> groups(m_numJacobianColours);
+    for (TIndex j = 0; j < D; ++j)
+      groups[m_jacobianColours[j]].push_back(j);
+    // nonzeros of each column, every column is written by a single thread
+    std::vector<std::vector<Scalar>> values(D);
+    finiteConstraintDifferences(x, groups, [&](TIndex j, const TConstraints &diff) {
+      for (TIndex i : m_jacobianPattern[j])
+        values[j].push_back(diff[i]);
+    });
+    std::vector<Eigen::Triplet<Scalar>> entries;
+    for (TIndex j = 0; j < D; ++j) {
+      for (size_t k = 0; k < m_jacobianPattern[j].size(); ++k)
+        entries.push_back(Eigen::Triplet<Scalar>(m_jacobianPattern[j][k], j, values[j][k]));
+    }
+    J.resize(numConstraints(), D);
+    J.setFromTriplets(entries.begin(), entries.end());
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // CONSTRAINEDPROBLEM_H
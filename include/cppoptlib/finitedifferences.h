@@ -0,0 +1,306 @@
+// CppNumericalSolver
+#ifndef FINITEDIFFERENCES_H
+#define FINITEDIFFERENCES_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <Eigen/Core>
+
+#include "parallel.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief central difference stencil: sum_s weights[s] f(x + offsets[s] h) / (denominator h)
+ */
+template<typename Scalar>
+struct FiniteDifferenceStencil {
+  std::vector<Scalar> weights;
+  std::vector<Scalar> offsets;
+  Scalar denominator;
+
+  /**
+   * @brief stencils of order 2, 4, 6 and 8 for accuracy 0 to 3
+   */
+  static const FiniteDifferenceStencil &central(int accuracy) {
+    static const std::array<FiniteDifferenceStencil, 4> stencils = { {
+      { {1, -1}, {1, -1}, 2 },
+      { {1, -8, 8, -1}, {-2, -1, 1, 2}, 12 },
+      { {-1, 9, -45, 45, -9, 1}, {-3, -2, -1, 1, 2, 3}, 60 },
+      { {3, -32, 168, -672, 672, -168, 32, -3}, {-4, -3, -2, -1, 1, 2, 3, 4}, 840 }
+    } };
+    return stencils[accuracy];
+  }
+};
+
+/*
+ * The finite differences below are shared by Problem and StaticProblem, which only
+ * differ in how they evaluate the objective. Evaluators that take a thread index t
+ * are called concurrently with distinct t in [0, threads).
+ */
+
+/**
+ * @brief central difference gradient
+ * @details the perturbed points of a block of coordinates are evaluated as one batch,
+ *          the blocks hold at least minBlock coordinates but bound the memory
+ *
+ * @param accuracy stencil of FiniteDifferenceStencil::central, 0 to 3
+ * @param minBlock fewest coordinates per batch
+ * @param valueBatch callable void(const TBatch &X, TBatchValues &f), one point per column
+ */
+template<typename TVector, typename ValueBatch>
+void finiteDifferenceGradient(const TVector &x, TVector &grad, int accuracy,
+                              typename TVector::Index minBlock, ValueBatch valueBatch) {
+  using Scalar = typename TVector::Scalar;
+  using TIndex = typename TVector::Index;
+  using TBatch = Eigen::Matrix<Scalar, TVector::RowsAtCompileTime, Eigen::Dynamic>;
+  using TBatchValues = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+  const Scalar eps = 2.2204e-6;
+  const FiniteDifferenceStencil<Scalar> &stencil = FiniteDifferenceStencil<Scalar>::central(accuracy);
+
+  const TIndex D = x.rows();
+  grad.resize(D);
+
+  const int innerSteps = 2*(accuracy+1);
+  const Scalar ddVal = stencil.denominator*eps;
+
+  const TIndex block = std::max<TIndex>(std::min<TIndex>(D, (TIndex(1) << 20) / std::max<TIndex>(D * innerSteps, 1)),
+                                        std::min<TIndex>(minBlock, D));
+  TBatch X;
+  TBatchValues f;
+  for (TIndex d0 = 0; d0 < D; d0 += block) {
+    const TIndex n = std::min<TIndex>(block, D - d0);
+    X.resize(D, n * innerSteps);
+    for (TIndex k = 0; k < n; ++k) {
+      for (int s = 0; s < innerSteps; ++s) {
+        X.col(k * innerSteps + s) = x;
+        X(d0 + k, k * innerSteps + s) = x[d0 + k] + stencil.offsets[s]*eps;
+      }
+    }
+    valueBatch(X, f);
+    for (TIndex k = 0; k < n; ++k) {
+      Scalar sum = 0;
+      for (int s = 0; s < innerSteps; ++s)
+        sum += stencil.weights[s]*f[k * innerSteps + s];
+      grad[d0 + k] = sum / ddVal;
+    }
+  }
+}
+
+/**
+ * @brief hessian from differences of the objective value
+ * @details only the upper triangle is evaluated and mirrored. The step along x_i is
+ *          proportional to max(|x_i|, 1). For accuracy 0 forward second differences
+ *          share the unperturbed and the D single-axis values between all entries,
+ *          which needs 1 + D + D(D+1)/2 evaluations in total. Higher accuracies use a
+ *          16-point stencil per entry.
+ *
+ * @param threads number of threads
+ * @param value callable Scalar(int t, const TVector &x)
+ */
+template<typename TVector, typename THessian, typename Value>
+void finiteDifferenceHessian(const TVector &x, THessian &hessian, int accuracy, int threads, Value value) {
+  using std::abs;
+  using std::cbrt;
+  using std::sqrt;
+  using Scalar = typename TVector::Scalar;
+  using TIndex = typename TVector::Index;
+
+  const TIndex D = x.rows();
+  const Scalar eps = (accuracy == 0) ? cbrt(std::numeric_limits<Scalar>::epsilon())
+                                     : sqrt(cbrt(std::numeric_limits<Scalar>::epsilon()));
+  TVector steps(D);
+  for (TIndex i = 0; i < D; ++i)
+    steps[i] = eps * std::max(abs(x[i]), Scalar(1.));
+
+  hessian.resize(D, D);
+
+  // all entries (i, j) with i <= j
+  std::vector<std::pair<TIndex, TIndex>> pairs;
+  pairs.reserve(D * (D + 1) / 2);
+  for (TIndex i = 0; i < D; i++) {
+    for (TIndex j = i; j < D; j++) {
+      pairs.push_back(std::make_pair(i, j));
+    }
+  }
+
+  threads = std::max(threads, 1);
+  std::vector<TVector, Eigen::aligned_allocator<TVector>> xx(threads, x);
+
+  // value at x + si*h_i*e_i + sj*h_j*e_j on the copy of thread t
+  auto shifted = [&](int t, TIndex i, Scalar si, TIndex j, Scalar sj) -> Scalar {
+    const Scalar tmpi = xx[t][i];
+    const Scalar tmpj = xx[t][j];
+    xx[t][i] += si*steps[i];
+    xx[t][j] += sj*steps[j];
+    const Scalar f = value(t, xx[t]);
+    xx[t][i] = tmpi;
+    xx[t][j] = tmpj;
+    return f;
+  };
+
+  if(accuracy == 0) {
+    const Scalar f0 = value(0, x);
+    TVector fi(D);
+    parallelFor(0, D, threads, [&](int t, TIndex i) {
+      fi[i] = shifted(t, i, 1, i, 0);
+    });
+    parallelFor(0, pairs.size(), threads, [&](int t, TIndex k) {
+      const TIndex i = pairs[k].first;
+      const TIndex j = pairs[k].second;
+      const Scalar fij = shifted(t, i, 1, j, 1);
+      hessian(i, j) = (fij - fi[i] - fi[j] + f0) / (steps[i] * steps[j]);
+      hessian(j, i) = hessian(i, j);
+    });
+  } else {
+    /*
+      \displaystyle{{\frac{\partial^2{f}}{\partial{x}\partial{y}}}\approx
+      \frac{1}{600\,h^2} \left[\begin{matrix}
+        -63(f_{1,-2}+f_{2,-1}+f_{-2,1}+f_{-1,2})+\\
+        63(f_{-1,-2}+f_{-2,-1}+f_{1,2}+f_{2,1})+\\
+        44(f_{2,-2}+f_{-2,2}-f_{-2,-2}-f_{2,2})+\\
+        74(f_{-1,-1}+f_{1,1}-f_{1,-1}-f_{-1,1})
+      \end{matrix}\right] }
+    */
+    parallelFor(0, pairs.size(), threads, [&](int t, TIndex k) {
+      const TIndex i = pairs[k].first;
+      const TIndex j = pairs[k].second;
+
+      Scalar term_1 = 0;
+      term_1 += shifted(t, i, 1, j, -2);
+      term_1 += shifted(t, i, 2, j, -1);
+      term_1 += shifted(t, i, -2, j, 1);
+      term_1 += shifted(t, i, -1, j, 2);
+
+      Scalar term_2 = 0;
+      term_2 += shifted(t, i, -1, j, -2);
+      term_2 += shifted(t, i, -2, j, -1);
+      term_2 += shifted(t, i, 1, j, 2);
+      term_2 += shifted(t, i, 2, j, 1);
+
+      Scalar term_3 = 0;
+      term_3 += shifted(t, i, 2, j, -2);
+      term_3 += shifted(t, i, -2, j, 2);
+      term_3 -= shifted(t, i, -2, j, -2);
+      term_3 -= shifted(t, i, 2, j, 2);
+
+      Scalar term_4 = 0;
+      term_4 += shifted(t, i, -1, j, -1);
+      term_4 += shifted(t, i, 1, j, 1);
+      term_4 -= shifted(t, i, 1, j, -1);
+      term_4 -= shifted(t, i, -1, j, 1);
+
+      hessian(i, j) = (-63 * term_1+63 * term_2+44 * term_3+74 * term_4)/(600.0 * steps[i] * steps[j]);
+      hessian(j, i) = hessian(i, j);
+    });
+  }
+}
+
+/**
+ * @brief hessian from differences of the gradient
+ * @details uses D (accuracy 0, forward) or 2D (otherwise, central) gradient evaluations
+ *          and symmetrises the result
+ *
+ * @param threads number of threads
+ * @param gradient callable void(int t, const TVector &x, TVector &grad)
+ */
+template<typename TVector, typename THessian, typename Gradient>
+void finiteDifferenceHessianFromGradient(const TVector &x, THessian &hessian, int accuracy, int threads,
+                                         Gradient gradient) {
+  using std::sqrt;
+  using std::cbrt;
+  using std::abs;
+  using Scalar = typename TVector::Scalar;
+  using TIndex = typename TVector::Index;
+
+  const TIndex D = x.rows();
+  const Scalar eps = (accuracy == 0) ? sqrt(std::numeric_limits<Scalar>::epsilon())
+                                     : cbrt(std::numeric_limits<Scalar>::epsilon());
+
+  hessian.resize(D, D);
+
+  TVector grad0;
+  if (accuracy == 0) {
+    grad0.resize(D);
+    gradient(0, x, grad0);
+  }
+
+  threads = std::max(threads, 1);
+  std::vector<TVector, Eigen::aligned_allocator<TVector>> xx(threads, x);
+  std::vector<TVector, Eigen::aligned_allocator<TVector>> gradPlus(threads, TVector(D));
+  std::vector<TVector, Eigen::aligned_allocator<TVector>> gradMinus(threads, TVector(D));
+
+  parallelFor(0, D, threads, [&](int t, TIndex j) {
+    const Scalar tmp = xx[t][j];
+    const Scalar h = eps * std::max(abs(tmp), Scalar(1.));
+    xx[t][j] = tmp + h;
+    gradient(t, xx[t], gradPlus[t]);
+    if (accuracy == 0) {
+      hessian.col(j) = (gradPlus[t] - grad0) / h;
+    } else {
+      xx[t][j] = tmp - h;
+      gradient(t, xx[t], gradMinus[t]);
+      hessian.col(j) = (gradPlus[t] - gradMinus[t]) / (2 * h);
+    }
+    xx[t][j] = tmp;
+  });
+
+  hessian = (0.5 * (hessian + hessian.transpose())).eval();
+}
+
+/**
+ * @brief forward difference of the gradient along v
+ * @details needs a single gradient evaluation, the gradient has to be exact
+ *
+ * @param grad gradient in x
+ * @param gradient callable void(const TVector &x, TVector &grad)
+ */
+template<typename TVector, typename Gradient>
+void forwardDifferenceHessianVectorProduct(const TVector &x, const TVector &grad, const TVector &v, TVector &Hv,
+                                           Gradient gradient) {
+  using std::sqrt;
+  using Scalar = typename TVector::Scalar;
+  const Scalar norm = v.norm();
+  if (norm == 0) {
+    Hv = TVector::Zero(x.rows());
+    return;
+  }
+  const Scalar h = sqrt(std::numeric_limits<Scalar>::epsilon()) * std::max(x.norm(), Scalar(1.)) / norm;
+  const TVector xx = x + h * v;
+  Hv.resize(x.rows());
+  gradient(xx, Hv);
+  Hv = (Hv - grad) / h;
+}
+
+/**
+ * @brief central difference of the gradient along v
+ * @details the larger step tolerates a gradient that is itself a finite difference
+ *
+ * @param gradient callable void(const TVector &x, TVector &grad)
+ */
+template<typename TVector, typename Gradient>
+void centralDifferenceHessianVectorProduct(const TVector &x, const TVector &v, TVector &Hv, Gradient gradient) {
+  using std::sqrt;
+  using Scalar = typename TVector::Scalar;
+  const Scalar norm = v.norm();
+  if (norm == 0) {
+    Hv = TVector::Zero(x.rows());
+    return;
+  }
+  const Scalar h = sqrt(sqrt(std::numeric_limits<Scalar>::epsilon())) * std::max(x.norm(), Scalar(1.)) / norm;
+  TVector xx = x + h * v, grad(x.rows());
+  Hv.resize(x.rows());
+  gradient(xx, Hv);
+  xx = x - h * v;
+  gradient(xx, grad);
+  Hv = (Hv - grad) / (2 * h);
+}
+
+} // end namespace cppoptlib
+
+#endif // FINITEDIFFERENCES_H
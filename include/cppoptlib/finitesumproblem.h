@@ -0,0 +1,197 @@
+// CppNumericalSolver
+#ifndef FINITESUMPROBLEM_H
+#define FINITESUMPROBLEM_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <vector>
+#include <Eigen/Core>
+
+#include "parallel.h"
+#include "problem.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief objective that is a mean of many terms f(x) = 1/N sum_i f_i(x)
+ * @details typical for data fitting, where every term is the loss of one sample. Only
+ *          minibatchValue() has to be implemented. It returns the mean over an arbitrary
+ *          subset of the terms, which is an unbiased estimate of f for stochastic solvers.
+ *          The full value and gradient are evaluated in contiguous blocks of blockSize()
+ *          terms on numThreads() threads, so the minibatch functions must be thread-safe
+ *          when more than one thread is used.
+ *
+ *          The minibatch functions have their own names rather than overloading
+ *          value() and gradient(), so that deriving classes do not hide the full versions.
+ */
+template<typename Scalar_, int Dim_ = Eigen::Dynamic>
+class FiniteSumProblem : public Problem<Scalar_, Dim_> {
+ public:
+  using Superclass = Problem<Scalar_, Dim_>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using typename Superclass::TIndex;
+  using TIndices = std::vector<TIndex>;
+
+ protected:
+  TIndex m_blockSize = 4096;
+
+  // calls body(t, indices, weight) for every block of terms, weight is the block's share of N
+  template<typename Body>
+  void forEachBlock(Body body) {
+    const TIndex N = numTerms();
+    const TIndex blocks = (N + m_blockSize - 1) / m_blockSize;
+    const int threads = static_cast<int>(std::min<TIndex>(this->m_threads, std::max<TIndex>(blocks, 1)));
+    std::vector<TIndices> indices(threads);
+    parallelFor(0, blocks, threads, [&](int t, TIndex b) {
+      const TIndex first = b * m_blockSize;
+      indices[t].resize(std::min(m_blockSize, N - first));
+      std::iota(indices[t].begin(), indices[t].end(), first);
+      body(t, indices[t], Scalar(indices[t].size()) / Scalar(N));
+    });
+  }
+
+ public:
+  FiniteSumProblem() : Superclass() {}
+
+  /**
+   * @brief number of terms N
+   */
+  virtual TIndex numTerms() const = 0;
+
+  /**
+   * @brief number of terms evaluated at once by value() and gradient()
+   */
+  void setBlockSize(TIndex blockSize) { m_blockSize = std::max<TIndex>(blockSize, 1); }
+  TIndex blockSize() const { return m_blockSize; }
+
+  /**
+   * @brief mean of the terms in indices
+   */
+  virtual Scalar minibatchValue(const TVector &x, const TIndices &indices) = 0;
+
+  /**
+   * @brief gradient of minibatchValue()
+   * @details should be overwritten, central differences by default
+   */
+  virtual void minibatchGradient(const TVector &x, const TIndices &indices, TVector &grad) {
+    using std::abs;
+    using std::cbrt;
+    const Scalar eps = cbrt(std::numeric_limits<Scalar>::epsilon());
+    TVector xx = x;
+    grad.resize(x.rows());
+    for (TIndex d = 0; d < x.rows(); ++d) {
+      const Scalar h = eps * std::max(abs(x[d]), Scalar(1.));
+      xx[d] = x[d] + h;
+      const Scalar plus = minibatchValue(xx, indices);
+      xx[d] = x[d] - h;
+      const Scalar minus = minibatchValue(xx, indices);
+      xx[d] = x[d];
+      grad[d] = (plus - minus) / (2 * h);
+    }
+  }
+
+  /**
+   * @brief minibatch value and gradient
+   * @details should be overwritten if both share work
+   */
+  virtual Scalar minibatchValueAndGradient(const TVector &x, const TIndices &indices, TVector &grad) {
+    minibatchGradient(x, indices, grad);
+    return minibatchValue(x, indices);
+  }
+
+  Scalar value(const TVector &x) {
+    std::vector<Scalar> sums(this->m_threads, Scalar(0));
+    forEachBlock([&](int t, const TIndices &indices, Scalar weight) {
+      sums[t] += weight * minibatchValue(x, indices);
+    });
+    return std::accumulate(sums.begin(), sums.end(), Scalar(0));
+  }
+
+  void gradient(const TVector &x, TVector &grad) {
+    valueAndGradient(x, grad);
+  }
+
+  Scalar valueAndGradient(const TVector &x, TVector &grad) {
+    std::vector<Scalar> sums(this->m_threads, Scalar(0));
+    std::vector<TVector, Eigen::aligned_allocator<TVector>> grads(this->m_threads, TVector::Zero(x.rows()));
+    std::vector<TVector, Eigen::aligned_allocator<TVector>> blockGrad(this->m_threads, TVector(x.rows()));
+    forEachBlock([&](int t, const TIndices &indices, Scalar weight) {
+      sums[t] += weight * minibatchValueAndGradient(x, indices, blockGrad[t]);
+      grads[t] += weight * blockGrad[t];
+    });
+    grad = grads[0];
+    for (size_t t = 1; t < grads.size(); ++t)
+      grad += grads[t];
+    return std::accumulate(sums.begin(), sums.end(), Scalar(0));
+  }
+};
+
+/**
+ * @brief draws the terms of a finite sum in shuffled minibatches, epoch by epoch
+ * @details every epoch visits each of the N terms exactly once in a new random order.
+ *          The last minibatch of an epoch is smaller if N is not a multiple of the
+ *          batch size. No memory is allocated after construction.
+ *
+ *          MinibatchSampler<Problem::TIndex> sampler(f.numTerms(), 64);
+ *          while (sampler.epoch() < epochs) {
+ *            sampler.next(batch);
+ *            f.minibatchGradient(x, batch, grad);
+ *            ...
+ *          }
+ */
+template<typename TIndex>
+class MinibatchSampler {
+ protected:
+  std::vector<TIndex> m_order;
+  TIndex m_batchSize;
+  TIndex m_position = 0;
+  TIndex m_epoch = 0;
+  std::mt19937 m_generator;
+
+ public:
+  MinibatchSampler(TIndex numTerms, TIndex batchSize, unsigned int seed = 0)
+      : m_order(numTerms), m_batchSize(std::max<TIndex>(batchSize, 1)), m_generator(seed) {
+    std::iota(m_order.begin(), m_order.end(), TIndex(0));
+    shuffle();
+  }
+
+  /**
+   * @brief starts a new epoch in a new random order
+   */
+  void shuffle() {
+    std::shuffle(m_order.begin(), m_order.end(), m_generator);
+    m_position = 0;
+  }
+
+  /**
+   * @brief number of completed epochs
+   */
+  TIndex epoch() const { return m_epoch; }
+  TIndex batchSize() const { return m_batchSize; }
+  // current order of the terms
+  const std::vector<TIndex> &order() const { return m_order; }
+
+  /**
+   * @brief copies the next minibatch into batch
+   * @return true if the minibatch completes an epoch, the next call starts a new one
+   */
+  bool next(std::vector<TIndex> &batch) {
+    const TIndex N = m_order.size();
+    const TIndex n = std::min(m_batchSize, N - m_position);
+    batch.assign(m_order.begin() + m_position, m_order.begin() + m_position + n);
+    m_position += n;
+    if (m_position < N)
+      return false;
+    ++m_epoch;
+    shuffle();
+    return true;
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // FINITESUMPROBLEM_H
@@ -0,0 +1,122 @@
+// CppNumericalSolver
+#ifndef INSTRUMENTEDPROBLEM_H
+#define INSTRUMENTEDPROBLEM_H
+
+#include <Eigen/Core>
+
+#include "problem.h"
+#include "statistics.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief counts and times the calls a solver makes to a problem
+ * @details wraps any problem and records number and latency of value, gradient,
+ *          valueAndGradient, hessian, hessianVectorProduct and valueBatch calls. Only
+ *          calls made through the wrapper are seen, e.g. a finite difference gradient
+ *          of the wrapped problem counts as one gradient call. Solvers copy the
+ *          statistics at the end of minimize(), see ISolver::evaluations().
+ *          The wrapped problem must outlive the wrapper.
+ *
+ * @tparam ProblemType problem to wrap
+ */
+template<typename ProblemType>
+class InstrumentedProblem : public Problem<typename ProblemType::Scalar, ProblemType::Dim> {
+ public:
+  using Superclass = Problem<typename ProblemType::Scalar, ProblemType::Dim>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using typename Superclass::THessian;
+  using typename Superclass::TCriteria;
+  using typename Superclass::TBatch;
+  using typename Superclass::TBatchValues;
+  using Clock = CallRecorder::Clock;
+
+ protected:
+  ProblemType &m_problem;
+  CallRecorder m_value;
+  CallRecorder m_gradient;
+  CallRecorder m_valueAndGradient;
+  CallRecorder m_hessian;
+  CallRecorder m_hessianVectorProduct;
+  CallRecorder m_valueBatch;
+
+ public:
+  explicit InstrumentedProblem(ProblemType &problem) : Superclass(), m_problem(problem) {}
+
+  ProblemType &problem() { return m_problem; }
+
+  EvaluationStatistics statistics() const {
+    EvaluationStatistics s;
+    s.value = m_value.snapshot();
+    s.gradient = m_gradient.snapshot();
+    s.valueAndGradient = m_valueAndGradient.snapshot();
+    s.hessian = m_hessian.snapshot();
+    s.hessianVectorProduct = m_hessianVectorProduct.snapshot();
+    s.valueBatch = m_valueBatch.snapshot();
+    return s;
+  }
+
+  void resetStatistics() {
+    m_value.reset();
+    m_gradient.reset();
+    m_valueAndGradient.reset();
+    m_hessian.reset();
+    m_hessianVectorProduct.reset();
+    m_valueBatch.reset();
+  }
+
+  bool callback(const TCriteria &state, const TVector &x) {
+    return m_problem.callback(state, x);
+  }
+
+  Scalar value(const TVector &x) {
+    const Clock::time_point start = Clock::now();
+    const Scalar f = m_problem.value(x);
+    m_value.record(start);
+    return f;
+  }
+
+  bool hasAnalyticGradient() const {
+    return m_problem.hasAnalyticGradient();
+  }
+
+  void gradient(const TVector &x, TVector &grad) {
+    const Clock::time_point start = Clock::now();
+    m_problem.gradient(x, grad);
+    m_gradient.record(start);
+  }
+
+  Scalar valueAndGradient(const TVector &x, TVector &grad) {
+    const Clock::time_point start = Clock::now();
+    const Scalar f = m_problem.valueAndGradient(x, grad);
+    m_valueAndGradient.record(start);
+    return f;
+  }
+
+  void hessian(const TVector &x, THessian &hessian) {
+    const Clock::time_point start = Clock::now();
+    m_problem.hessian(x, hessian);
+    m_hessian.record(start);
+  }
+
+  void hessianVectorProduct(const TVector &x, const TVector &v, TVector &Hv) {
+    const Clock::time_point start = Clock::now();
+    m_problem.hessianVectorProduct(x, v, Hv);
+    m_hessianVectorProduct.record(start);
+  }
+
+  void valueBatch(const TBatch &X, TBatchValues &f) {
+    const Clock::time_point start = Clock::now();
+    m_problem.valueBatch(X, f);
+    m_valueBatch.record(start);
+  }
+
+  // box constraints of the wrapped problem (only instantiated for bounded problems)
+  const TVector &lowerBound() const { return m_problem.lowerBound(); }
+  const TVector &upperBound() const { return m_problem.upperBound(); }
+};
+
+} // end namespace cppoptlib
+
+#endif // INSTRUMENTEDPROBLEM_H
@@ -0,0 +1,138 @@
+// CppNumericalSolver
+#ifndef LEASTSQUARESPROBLEM_H
+#define LEASTSQUARESPROBLEM_H
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <Eigen/Core>
+
+#include "parallel.h"
+#include "problem.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief nonlinear least squares f(x) = 1/2 ||r(x)||^2
+ * @details only residuals() has to be implemented. The gradient J^T r and the
+ *          Gauss-Newton approximation J^T J of the hessian are derived from the jacobian
+ *          J of the residuals, so every solver gets curvature information from first
+ *          derivatives only. hessian() is exact only where the residuals vanish or are
+ *          linear, checkHessian() therefore fails for nonzero residuals of nonlinear
+ *          models. jacobian() falls back to central differences on numThreads() threads.
+ *          See ForwardDiffLeastSquaresProblem for an exact jacobian of templated
+ *          residuals.
+ *
+ * @tparam NRes number of residuals, if known at compile time
+ */
+template<typename Scalar_, int NRes_ = Eigen::Dynamic, int Dim_ = Eigen::Dynamic>
+class LeastSquaresProblem : public Problem<Scalar_, Dim_> {
+ public:
+  static const int NRes = NRes_;
+  using Superclass = Problem<Scalar_, Dim_>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using typename Superclass::THessian;
+  using typename Superclass::TIndex;
+  using TResiduals = Eigen::Matrix<Scalar, NRes, 1>;
+  using TJacobian = Eigen::Matrix<Scalar, NRes, Dim_>;
+
+ protected:
+  TResiduals m_residuals;
+  TJacobian m_jacobian;
+
+ public:
+  LeastSquaresProblem() : Superclass() {}
+
+  /**
+   * @brief residuals r(x)
+   */
+  virtual void residuals(const TVector &x, TResiduals &r) = 0;
+
+  /**
+   * @brief jacobian of the residuals, J(i, j) = d r_i / d x_j
+   * @details should be overwritten by a symbolic jacobian
+   */
+  virtual void jacobian(const TVector &x, TJacobian &J) {
+    finiteJacobian(x, J);
+  }
+
+  /**
+   * @brief residuals and jacobian at the same point
+   * @details should be overwritten if both share work
+   */
+  virtual void residualsAndJacobian(const TVector &x, TResiduals &r, TJacobian &J) {
+    residuals(x, r);
+    jacobian(x, J);
+  }
+
+  /**
+   * @brief central differences of the residuals, one column per coordinate
+   */
+  void finiteJacobian(const TVector &x, TJacobian &J) {
+    using std::abs;
+    using std::cbrt;
+    const Scalar eps = cbrt(std::numeric_limits<Scalar>::epsilon());
+    const TIndex D = x.rows();
+    const int threads = static_cast<int>(std::min<TIndex>(this->m_threads, std::max<TIndex>(D, 1)));
+    std::vector<std::unique_ptr<Superclass>> owned;
+    const std::vector<Superclass *> problems = this->threadProblems(threads, owned);
+    std::vector<TVector, Eigen::aligned_allocator<TVector>> xx(threads, x);
+    std::vector<TResiduals, Eigen::aligned_allocator<TResiduals>> plus(threads), minus(threads);
+    // one evaluation in x for the number of residuals
+    residuals(x, plus[0]);
+    J.resize(plus[0].rows(), D);
+    parallelFor(0, D, threads, [&](int t, TIndex j) {
+      // all clones of a least squares problem are least squares problems
+      LeastSquaresProblem *problem = static_cast<LeastSquaresProblem *>(problems[t]);
+      const Scalar h = eps * std::max(abs(x[j]), Scalar(1.));
+      xx[t][j] = x[j] + h;
+      problem->residuals(xx[t], plus[t]);
+      xx[t][j] = x[j] - h;
+      problem->residuals(xx[t], minus[t]);
+      xx[t][j] = x[j];
+      J.col(j) = (plus[t] - minus[t]) / (2 * h);
+    });
+  }
+
+  Scalar value(const TVector &x) {
+    // value() may be called concurrently, see valueBatch()
+    TResiduals r;
+    residuals(x, r);
+    return Scalar(0.5) * r.squaredNorm();
+  }
+
+  void gradient(const TVector &x, TVector &grad) {
+    valueAndGradient(x, grad);
+  }
+
+  Scalar valueAndGradient(const TVector &x, TVector &grad) {
+    residualsAndJacobian(x, m_residuals, m_jacobian);
+    grad.noalias() = m_jacobian.transpose() * m_residuals;
+    return Scalar(0.5) * m_residuals.squaredNorm();
+  }
+
+  /**
+   * @brief Gauss-Newton approximation J^T J of the hessian
+   */
+  void hessian(const TVector &x, THessian &hessian) {
+    jacobian(x, m_jacobian);
+    hessian.resize(x.rows(), x.rows());
+    hessian.setZero();
+    hessian.template selfadjointView<Eigen::Lower>().rankUpdate(m_jacobian.transpose());
+    hessian.template triangularView<Eigen::StrictlyUpper>() = hessian.transpose();
+  }
+
+  /**
+   * @brief Gauss-Newton product J^T (J v)
+   */
+  void hessianVectorProduct(const TVector &x, const TVector &v, TVector &Hv) {
+    jacobian(x, m_jacobian);
+    Hv.noalias() = m_jacobian.transpose() * (m_jacobian * v);
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // LEASTSQUARESPROBLEM_H
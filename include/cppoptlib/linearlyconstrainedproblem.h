@@ -0,0 +1,182 @@
+// CppNumericalSolver
+#ifndef LINEARLYCONSTRAINEDPROBLEM_H
+#define LINEARLYCONSTRAINEDPROBLEM_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+#include "boundedproblem.h"
+#include "projection.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief problem on a polyhedron {A x <= b, Aeq x = beq, lower <= x <= upper}
+ * @details the feasible set is accessed by projected gradient methods through project().
+ *          For the simplex declared by setSimplexConstraint() this is the exact
+ *          O(n log n) projection. Otherwise Dykstra's alternating projections onto the
+ *          box and every single halfspace and hyperplane are used, which costs O(nnz(A) + n)
+ *          per sweep and converges to the euclidean projection. Problems with another
+ *          structure, e.g. an l1 ball, should override project() with the exact projection
+ *          (see projection.h). The constraint matrices are stored sparse row by row.
+ */
+template<typename Scalar_, int Dim_ = Eigen::Dynamic>
+class LinearlyConstrainedProblem : public BoundedProblem<Scalar_, Dim_> {
+ public:
+  using Superclass = BoundedProblem<Scalar_, Dim_>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using TIndex = typename TVector::Index;
+  using TConstraints = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+  using TMatrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+  using TSparseMatrix = Eigen::SparseMatrix<Scalar, Eigen::RowMajor>;
+
+ protected:
+  TSparseMatrix m_A;
+  TConstraints m_b;
+  TSparseMatrix m_Aeq;
+  TConstraints m_beq;
+  bool m_simplex = false;
+  Scalar m_simplexRadius = 1;
+  int m_projectionIterations = 1000;
+  Scalar m_projectionTolerance = 1e-10;
+
+  // dykstra corrections of the rows of A and Aeq
+  TConstraints m_multipliers;
+  TConstraints m_multipliersEq;
+
+  // projects y onto {a x <= b} (equality = false) or {a x = b} and returns the multiple
+  // of a that has been subtracted
+  static Scalar projectOntoRow(const TSparseMatrix &A, TIndex i, Scalar b, bool equality, TVector &y) {
+    Scalar ay = 0, aa = 0;
+    for (typename TSparseMatrix::InnerIterator it(A, i); it; ++it) {
+      ay += it.value() * y[it.col()];
+      aa += it.value() * it.value();
+    }
+    if ((aa == 0) || (!equality && (ay <= b)))
+      return 0;
+    const Scalar mu = (ay - b) / aa;
+    for (typename TSparseMatrix::InnerIterator it(A, i); it; ++it)
+      y[it.col()] -= mu * it.value();
+    return mu;
+  }
+
+  // adds back the correction mu a_i of the previous sweep
+  static void addRow(const TSparseMatrix &A, TIndex i, Scalar mu, TVector &y) {
+    if (mu == 0)
+      return;
+    for (typename TSparseMatrix::InnerIterator it(A, i); it; ++it)
+      y[it.col()] += mu * it.value();
+  }
+
+ public:
+  LinearlyConstrainedProblem(int RunDim = Dim_) : Superclass(RunDim) {}
+
+  LinearlyConstrainedProblem(const TVector &l, const TVector &u) : Superclass(l, u) {}
+
+  /**
+   * @brief declares the inequalities A x <= b
+   */
+  void setInequalities(const TSparseMatrix &A, const TConstraints &b) {
+    m_A = A;
+    m_b = b;
+    m_simplex = false;
+  }
+  void setInequalities(const TMatrix &A, const TConstraints &b) { setInequalities(TSparseMatrix(A.sparseView()), b); }
+
+  /**
+   * @brief declares the equalities Aeq x = beq
+   */
+  void setEqualities(const TSparseMatrix &Aeq, const TConstraints &beq) {
+    m_Aeq = Aeq;
+    m_beq = beq;
+    m_simplex = false;
+  }
+  void setEqualities(const TMatrix &Aeq, const TConstraints &beq) { setEqualities(TSparseMatrix(Aeq.sparseView()), beq); }
+
+  /**
+   * @brief restricts x to the simplex {x >= 0, sum x = radius} of dimension D
+   * @details replaces all other constraints
+   */
+  void setSimplexConstraint(TIndex D, Scalar radius = 1) {
+    TMatrix ones = TMatrix::Ones(1, D);
+    setEqualities(ones, TConstraints::Constant(1, radius));
+    setInequalities(TSparseMatrix(0, D), TConstraints(0));
+    this->setBoxConstraint(TVector::Zero(D), TVector::Constant(D, std::numeric_limits<Scalar>::infinity()));
+    m_simplex = true;
+    m_simplexRadius = radius;
+  }
+
+  const TSparseMatrix &inequalityMatrix() const { return m_A; }
+  const TConstraints &inequalityBound() const { return m_b; }
+  const TSparseMatrix &equalityMatrix() const { return m_Aeq; }
+  const TConstraints &equalityBound() const { return m_beq; }
+
+  /**
+   * @brief limits of the alternating projections used for general polyhedra
+   */
+  void setProjectionTolerance(Scalar tolerance, int iterations) {
+    m_projectionTolerance = tolerance;
+    m_projectionIterations = iterations;
+  }
+
+  /**
+   * @brief largest violation of the linear constraints and the box in x
+   */
+  Scalar constraintViolation(const TVector &x) const {
+    Scalar violation = 0;
+    if (m_A.rows() > 0)
+      violation = std::max(violation, (m_A * x - m_b).maxCoeff());
+    if (m_Aeq.rows() > 0)
+      violation = std::max(violation, (m_Aeq * x - m_beq).template lpNorm<Eigen::Infinity>());
+    if (x.rows() > 0) {
+      violation = std::max(violation, (this->m_lowerBound - x).maxCoeff());
+      violation = std::max(violation, (x - this->m_upperBound).maxCoeff());
+    }
+    return violation;
+  }
+
+  /**
+   * @brief replaces x by its euclidean projection onto the feasible set
+   */
+  virtual void project(TVector &x) {
+    if (m_simplex) {
+      projectOntoSimplex(x, m_simplexRadius, x);
+      return;
+    }
+    if ((m_A.rows() == 0) && (m_Aeq.rows() == 0)) {
+      projectOntoBox(x, this->m_lowerBound, this->m_upperBound, x);
+      return;
+    }
+    // Dykstra: every set keeps the correction it applied in the previous sweep. For the
+    // rows it is a multiple of the row, for the box a full vector.
+    m_multipliers.setZero(m_A.rows());
+    m_multipliersEq.setZero(m_Aeq.rows());
+    TVector boxCorrection = TVector::Zero(x.rows()), y, previous;
+    for (int sweep = 0; sweep < m_projectionIterations; ++sweep) {
+      previous = x;
+      for (TIndex i = 0; i < m_A.rows(); ++i) {
+        addRow(m_A, i, m_multipliers[i], x);
+        m_multipliers[i] = projectOntoRow(m_A, i, m_b[i], false, x);
+      }
+      for (TIndex i = 0; i < m_Aeq.rows(); ++i) {
+        addRow(m_Aeq, i, m_multipliersEq[i], x);
+        m_multipliersEq[i] = projectOntoRow(m_Aeq, i, m_beq[i], true, x);
+      }
+      y = x + boxCorrection;
+      projectOntoBox(y, this->m_lowerBound, this->m_upperBound, x);
+      boxCorrection = y - x;
+      if (((x - previous).template lpNorm<Eigen::Infinity>() < m_projectionTolerance)
+          && (constraintViolation(x) < m_projectionTolerance))
+        break;
+    }
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // LINEARLYCONSTRAINEDPROBLEM_H
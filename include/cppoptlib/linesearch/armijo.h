@@ -25,9 +25,8 @@ public:
         const Scalar rho = 0.9;
         Scalar alpha = alpha_init;
         Scalar f = objFunc.value(x + alpha * searchDir);
-        const Scalar f_in = objFunc.value(x);
         TVector grad(x.rows());
-        objFunc.gradient(x, grad);
+        const Scalar f_in = objFunc.valueAndGradient(x, grad);
         const Scalar Cache = c * grad.dot(searchDir);
 
         while(f > f_in + alpha * Cache) {
@@ -44,9 +43,9 @@ template<typename ProblemType>
 class Armijo<ProblemType, 2> {
 
  public:
-    using typename ProblemType::Scalar;
-    using typename ProblemType::TVector;
-    using typename ProblemType::THessian;
+    using Scalar = typename ProblemType::Scalar;
+    using TVector = typename ProblemType::TVector;
+    using THessian = typename ProblemType::THessian;
     /**
      * @brief use Armijo Rule for (weak) Wolfe conditiions
      * @details [long description]
@@ -62,11 +61,10 @@ class Armijo<ProblemType, 2> {
         Scalar alpha = 1.0;
 
         Scalar f = objFunc.value(x + alpha * searchDir);
-        const Scalar f_in = objFunc.value(x);
-        const THessian  hessian(x.rows(), x.rows());
+        THessian hessian(x.rows(), x.rows());
         objFunc.hessian(x, hessian);
         TVector grad(x.rows());
-        objFunc.gradient(x, grad);
+        const Scalar f_in = objFunc.valueAndGradient(x, grad);
         const Scalar Cache = c * grad.dot(searchDir) + 0.5 * c*c * searchDir.transpose() * (hessian * searchDir);
 
         while(f > f_in + alpha * Cache) {
@@ -0,0 +1,64 @@
+// CppNumericalSolver
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+#include <Eigen/Core>
+
+namespace cppoptlib {
+
+/**
+ * @brief runs body(thread, i) for all i in [begin, end) on up to `threads` threads
+ * @details the range is split into contiguous blocks, block t is handled by thread t.
+ *          The calling thread works on block 0, so threads <= 1 runs everything inline.
+ *          The first exception thrown by any block is rethrown after all threads joined.
+ *
+ * @param begin first index
+ * @param end one past the last index
+ * @param threads number of threads to use
+ * @param body callable with signature void(int thread, Eigen::DenseIndex i)
+ */
+template<typename Function>
+void parallelFor(Eigen::DenseIndex begin, Eigen::DenseIndex end, int threads, Function body) {
+  const Eigen::DenseIndex n = end - begin;
+  if (n <= 0)
+    return;
+  threads = static_cast<int>(std::max<Eigen::DenseIndex>(1, std::min<Eigen::DenseIndex>(threads, n)));
+  if (threads == 1) {
+    for (Eigen::DenseIndex i = begin; i < end; ++i)
+      body(0, i);
+    return;
+  }
+
+  const Eigen::DenseIndex chunk = (n + threads - 1) / threads;
+  std::vector<std::exception_ptr> errors(threads);
+  auto block = [&](int t) {
+    try {
+      const Eigen::DenseIndex first = begin + t * chunk;
+      const Eigen::DenseIndex last = std::min(end, first + chunk);
+      for (Eigen::DenseIndex i = first; i < last; ++i)
+        body(t, i);
+    } catch (...) {
+      errors[t] = std::current_exception();
+    }
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  for (int t = 1; t < threads; ++t)
+    pool.emplace_back(block, t);
+  block(0);
+  for (auto &th : pool)
+    th.join();
+  for (auto &e : errors) {
+    if (e)
+      std::rethrow_exception(e);
+  }
+}
+
+} // end namespace cppoptlib
+
+#endif // PARALLEL_H
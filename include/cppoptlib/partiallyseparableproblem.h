@@ -0,0 +1,262 @@
+// CppNumericalSolver
+#ifndef PARTIALLYSEPARABLEPROBLEM_H
+#define PARTIALLYSEPARABLEPROBLEM_H
+
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+#include "parallel.h"
+#include "sparseproblem.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief objective that is a sum of element functions f(x) = sum_k f_k(x_k)
+ * @details every element depends on a small subset x_k of the variables, declared by
+ *          setElements(). Only elementValue() has to be implemented. It receives the
+ *          element's own variables, so the cost of a value, gradient or hessian is linear
+ *          in the number of elements. Elements are evaluated on numThreads() threads.
+ *          The gradient is assembled per variable, so no two threads ever write the
+ *          same entry. The sparsity of the hessian follows from the elements and is
+ *          declared on the SparseProblem automatically.
+ *
+ *          elementValue() and its derivatives are called concurrently and must be
+ *          thread-safe.
+ */
+template<typename Scalar_, int Dim_ = Eigen::Dynamic>
+class PartiallySeparableProblem : public SparseProblem<Scalar_, Dim_> {
+ public:
+  using Superclass = SparseProblem<Scalar_, Dim_>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using typename Superclass::THessian;
+  using typename Superclass::TIndex;
+  using typename Superclass::TSparseHessian;
+  using typename Superclass::TElementVector;
+  using typename Superclass::TMatrix;
+
+ protected:
+  std::vector<std::vector<TIndex>> m_elements;
+  // (element, position within the element) of every occurrence of a variable
+  std::vector<std::vector<std::pair<TIndex, TIndex>>> m_occurrences;
+  // point and element gradients of the last valueAndGradient() call
+  TVector m_lastPoint;
+  std::vector<TElementVector> m_lastGradients;
+
+  void gather(TIndex k, const TVector &x, TElementVector &xk) const {
+    const std::vector<TIndex> &variables = m_elements[k];
+    xk.resize(variables.size());
+    for (size_t i = 0; i < variables.size(); ++i)
+      xk[i] = x[variables[i]];
+  }
+
+  int elementThreads() const {
+    return static_cast<int>(std::min<TIndex>(this->m_threads, std::max<TIndex>(this->numElements(), 1)));
+  }
+
+ public:
+  PartiallySeparableProblem() : Superclass() {}
+
+  /**
+   * @brief declares the elements
+   *
+   * @param D number of variables
+   * @param variables indices of the variables element k depends on
+   */
+  void setElements(TIndex D, const std::vector<std::vector<TIndex>> &variables) {
+    this->setElementVariables(D, variables);
+    m_elements = variables;
+    m_lastGradients.clear();
+    m_occurrences.assign(D, std::vector<std::pair<TIndex, TIndex>>());
+    std::vector<Eigen::Triplet<Scalar>> entries;
+    for (size_t k = 0; k < variables.size(); ++k) {
+      for (size_t i = 0; i < variables[k].size(); ++i) {
+        m_occurrences[variables[k][i]].push_back(std::make_pair(TIndex(k), TIndex(i)));
+        for (TIndex j : variables[k])
+          entries.push_back(Eigen::Triplet<Scalar>(variables[k][i], j, Scalar(1)));
+      }
+    }
+    TSparseHessian pattern(D, D);
+    pattern.setFromTriplets(entries.begin(), entries.end());
+    this->setHessianSparsity(pattern);
+  }
+
+  const std::vector<TIndex> &elementVariables(TIndex k) const { return m_elements[k]; }
+
+  /**
+   * @brief value of element k on its own variables xk
+   */
+  virtual Scalar elementValue(TIndex k, const TElementVector &xk) = 0;
+
+  /**
+   * @brief gradient of element k with respect to its own variables
+   * @details should be overwritten, central differences by default
+   */
+  virtual void elementGradient(TIndex k, const TElementVector &xk, TElementVector &gk) {
+    using std::abs;
+    using std::cbrt;
+    const Scalar eps = cbrt(std::numeric_limits<Scalar>::epsilon());
+    TElementVector xx = xk;
+    gk.resize(xk.rows());
+    for (TIndex i = 0; i < xk.rows(); ++i) {
+      const Scalar h = eps * std::max(abs(xk[i]), Scalar(1.));
+      xx[i] = xk[i] + h;
+      const Scalar plus = elementValue(k, xx);
+      xx[i] = xk[i] - h;
+      const Scalar minus = elementValue(k, xx);
+      xx[i] = xk[i];
+      gk[i] = (plus - minus) / (2 * h);
+    }
+  }
+
+  /**
+   * @brief hessian of element k with respect to its own variables
+   * @details should be overwritten, central differences of elementGradient() by default
+   */
+  virtual void elementHessian(TIndex k, const TElementVector &xk, TMatrix &hk) {
+    using std::abs;
+    using std::sqrt;
+    const Scalar eps = sqrt(sqrt(std::numeric_limits<Scalar>::epsilon()));
+    const TIndex n = xk.rows();
+    TElementVector xx = xk, plus, minus;
+    hk.resize(n, n);
+    for (TIndex i = 0; i < n; ++i) {
+      const Scalar h = eps * std::max(abs(xk[i]), Scalar(1.));
+      xx[i] = xk[i] + h;
+      elementGradient(k, xx, plus);
+      xx[i] = xk[i] - h;
+      elementGradient(k, xx, minus);
+      xx[i] = xk[i];
+      hk.col(i) = (plus - minus) / (2 * h);
+    }
+    hk = (0.5 * (hk + hk.transpose())).eval();
+  }
+
+  /**
+   * @brief value and gradient of element k with respect to its own variables
+   * @details can be overwritten if both share work, elementGradient() and elementValue()
+   *          by default
+   */
+  virtual Scalar elementValueAndGradient(TIndex k, const TElementVector &xk, TElementVector &gk) {
+    elementGradient(k, xk, gk);
+    return elementValue(k, xk);
+  }
+
+  void elementValues(const TVector &x, TElementVector &values) {
+    values.resize(this->numElements());
+    std::vector<TElementVector> xk(elementThreads());
+    parallelFor(0, this->numElements(), elementThreads(), [&](int t, TIndex k) {
+      gather(k, x, xk[t]);
+      values[k] = elementValue(k, xk[t]);
+    });
+  }
+
+  /**
+   * @brief gradients of all elements with respect to their own variables
+   */
+  void elementGradients(const TVector &x, std::vector<TElementVector> &grads) {
+    grads.resize(this->numElements());
+    std::vector<TElementVector> xk(elementThreads());
+    parallelFor(0, this->numElements(), elementThreads(), [&](int t, TIndex k) {
+      gather(k, x, xk[t]);
+      elementGradient(k, xk[t], grads[k]);
+    });
+  }
+
+  /**
+   * @brief sums element gradients into the full gradient
+   */
+  void assembleGradient(const std::vector<TElementVector> &grads, TVector &grad) const {
+    const TIndex D = m_occurrences.size();
+    grad.resize(D);
+    const int threads = static_cast<int>(std::min<TIndex>(this->m_threads, std::max<TIndex>(D, 1)));
+    parallelFor(0, D, threads, [&](int, TIndex j) {
+      Scalar sum = 0;
+      for (const auto &o : m_occurrences[j])
+        sum += grads[o.first][o.second];
+      grad[j] = sum;
+    });
+  }
+
+  /**
+   * @brief sums element hessians into the full sparse hessian
+   * @details the diagonal is always stored, also for variables in no element, so the
+   *          pattern is the same at every point and admits a diagonal shift
+   */
+  void assembleHessian(const std::vector<TMatrix> &hessians, TSparseHessian &hessian) const {
+    const TIndex D = m_occurrences.size();
+    std::vector<Eigen::Triplet<Scalar>> entries;
+    for (TIndex j = 0; j < D; ++j)
+      entries.push_back(Eigen::Triplet<Scalar>(j, j, Scalar(0)));
+    for (TIndex k = 0; k < this->numElements(); ++k) {
+      const std::vector<TIndex> &variables = m_elements[k];
+      for (size_t j = 0; j < variables.size(); ++j) {
+        for (size_t i = 0; i < variables.size(); ++i)
+          entries.push_back(Eigen::Triplet<Scalar>(variables[i], variables[j], hessians[k](i, j)));
+      }
+    }
+    hessian.resize(D, D);
+    hessian.setFromTriplets(entries.begin(), entries.end());
+  }
+
+  Scalar value(const TVector &x) {
+    TElementVector values;
+    elementValues(x, values);
+    return values.sum();
+  }
+
+  void gradient(const TVector &x, TVector &grad) {
+    std::vector<TElementVector> grads;
+    elementGradients(x, grads);
+    assembleGradient(grads, grad);
+  }
+
+  /**
+   * @brief value and gradient in a single pass over the elements
+   * @details the element gradients are kept until they are taken by takeElementGradients()
+   */
+  Scalar valueAndGradient(const TVector &x, TVector &grad) {
+    TElementVector values(this->numElements());
+    m_lastGradients.resize(this->numElements());
+    std::vector<TElementVector> xk(elementThreads());
+    parallelFor(0, this->numElements(), elementThreads(), [&](int t, TIndex k) {
+      gather(k, x, xk[t]);
+      values[k] = elementValueAndGradient(k, xk[t], m_lastGradients[k]);
+    });
+    m_lastPoint = x;
+    assembleGradient(m_lastGradients, grad);
+    return values.sum();
+  }
+
+  /**
+   * @brief hands over the element gradients of the last valueAndGradient() call
+   * @details lets a solver reuse the gradients of the final line search step
+   *
+   * @return false, leaving grads untouched, unless that call was made in x
+   */
+  bool takeElementGradients(const TVector &x, std::vector<TElementVector> &grads) {
+    if (m_lastGradients.empty() || (m_lastPoint.rows() != x.rows()) || (m_lastPoint != x))
+      return false;
+    grads.swap(m_lastGradients);
+    m_lastGradients.clear();
+    return true;
+  }
+
+  void sparseHessian(const TVector &x, TSparseHessian &hessian) {
+    std::vector<TMatrix> hessians(this->numElements());
+    std::vector<TElementVector> xk(elementThreads());
+    parallelFor(0, this->numElements(), elementThreads(), [&](int t, TIndex k) {
+      gather(k, x, xk[t]);
+      elementHessian(k, xk[t], hessians[k]);
+    });
+    assembleHessian(hessians, hessian);
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // PARTIALLYSEPARABLEPROBLEM_H
@@ -2,10 +2,16 @@
 #define PROBLEM_H
 
 #include <array>
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <random>
 #include <vector>
 #include <Eigen/Core>
 
+#include "finitedifferences.h"
 #include "meta.h"
+#include "parallel.h"
 
 namespace cppoptlib {
 
@@ -18,11 +24,72 @@ class Problem {
   using THessian  = Eigen::Matrix<Scalar, Dim, Dim>;
   using TCriteria = Criteria<Scalar>;
   using TIndex = typename TVector::Index;
+  // points stored column by column and their objective values
+  using TBatch = Eigen::Matrix<Scalar, Dim, Eigen::Dynamic>;
+  using TBatchValues = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+ protected:
+  int m_threads = 1;
+
+  /**
+   * @brief returns one problem per thread
+   * @details thread 0 always uses this problem, the other threads use a clone if
+   *          the problem provides one and share this problem otherwise
+   *
+   * @param threads number of threads
+   * @param owned storage for the clones, must outlive the returned pointers
+   */
+  std::vector<Problem *> threadProblems(int threads, std::vector<std::unique_ptr<Problem>> &owned) {
+    std::vector<Problem *> problems(threads, this);
+    owned.clear();
+    for (int t = 1; t < threads; ++t) {
+      owned.push_back(clone());
+      if (owned.back())
+        problems[t] = owned.back().get();
+    }
+    return problems;
+  }
+
+  using Stencil = FiniteDifferenceStencil<Scalar>;
+
+  static const Stencil &centralStencil(int accuracy) { return Stencil::central(accuracy); }
+
+  // step of the directional differences along unit vectors
+  static Scalar stencilStep(const TVector &x) {
+    using std::cbrt;
+    return cbrt(std::numeric_limits<Scalar>::epsilon()) * std::max(x.template lpNorm<Eigen::Infinity>(), Scalar(1.));
+  }
+
+  // normally distributed direction of unit length
+  static void randomDirection(std::mt19937 &generator, TVector &v) {
+    std::normal_distribution<double> normal;
+    for (TIndex i = 0; i < v.rows(); ++i)
+      v[i] = Scalar(normal(generator));
+    v.normalize();
+  }
 
  public:
   Problem() {}
   virtual ~Problem()= default;
 
+  /**
+   * @brief number of threads used for finite differences
+   * @details with more than one thread value() is called concurrently, so it must
+   *          either be thread-safe or the problem has to override clone()
+   */
+  void setNumThreads(int threads) { m_threads = std::max(threads, 1); }
+  int numThreads() const { return m_threads; }
+
+  /**
+   * @brief returns an independent copy of this problem for use on another thread
+   * @details the default returns nullptr, which means all threads share this problem.
+   *          Override it if value() is not thread-safe, e.g.
+   *          return std::unique_ptr<Problem<double>>(new MyProblem(*this));
+   */
+  virtual std::unique_ptr<Problem> clone() const {
+    return nullptr;
+  }
+
   virtual bool callback(const Criteria<Scalar> &state, const TVector &x) {
     return true;
   }
@@ -45,6 +112,29 @@ class Problem {
   Scalar operator()(const  TVector &x) {
     return value(x);
   }
+  /**
+   * @brief returns the objective value of every column of X
+   * @details evaluates value() column by column on numThreads() threads. Should be
+   *          overwritten if many points can be evaluated at once more efficiently, e.g.
+   *          with one matrix product. Population based solvers and finite differences
+   *          evaluate their points through this function.
+   *
+   * @param X one point per column
+   * @param f receives the objective values
+   */
+  virtual void valueBatch(const TBatch &X, TBatchValues &f) {
+    const TIndex n = X.cols();
+    f.resize(n);
+    const int threads = static_cast<int>(std::min<TIndex>(m_threads, std::max<TIndex>(n, 1)));
+    std::vector<std::unique_ptr<Problem>> owned;
+    const std::vector<Problem *> problems = threadProblems(threads, owned);
+    std::vector<TVector, Eigen::aligned_allocator<TVector>> xx(threads);
+    parallelFor(0, n, threads, [&](int t, TIndex i) {
+      xx[t] = X.col(i);
+      f[i] = problems[t]->value(xx[t]);
+    });
+  }
+
   /**
    * @brief returns gradient in x as reference parameter
    * @details should be overwritten by symbolic gradient
@@ -55,24 +145,83 @@ class Problem {
     finiteGradient(x, grad);
   }
 
+  /**
+   * @brief whether gradient() is exact rather than a finite difference approximation
+   * @details should return true alongside a symbolic gradient. Hessians and hessian
+   *          vector products are then differences of the gradient, otherwise differences
+   *          of the objective value. Wrappers forward the answer of the wrapped problem.
+   */
+  virtual bool hasAnalyticGradient() const {
+    return false;
+  }
+
+  /**
+   * @brief returns objective value in x and the gradient as reference parameter
+   * @details should be overwritten if value and gradient share work (e.g. a common
+   *          matrix-vector product), solvers and line searches call this whenever
+   *          they need both at the same point
+   *
+   * @param x [description]
+   * @param grad [description]
+   * @return objective value in x
+   */
+  virtual Scalar valueAndGradient(const TVector &x, TVector &grad) {
+    gradient(x, grad);
+    return value(x);
+  }
+
   /**
    * @brief This computes the hessian
-   * @details should be overwritten by symbolic hessian, if solver relies on hessian
+   * @details should be overwritten by symbolic hessian, if solver relies on hessian.
+   *          Otherwise differences of the gradient are used if hasAnalyticGradient(),
+   *          and differences of the objective value if not.
    */
   virtual void hessian(const TVector &x, THessian &hessian) {
-    finiteHessian(x, hessian);
+    if (hasAnalyticGradient())
+      finiteHessianFromGradient(x, hessian);
+    else
+      finiteHessian(x, hessian);
+  }
+
+  /**
+   * @brief returns the product of the hessian in x with v, without forming the hessian
+   * @details should be overwritten by an analytic or automatically differentiated product.
+   *          Otherwise it is a forward difference of the gradient along v if
+   *          hasAnalyticGradient(), and a central difference with a larger step if not.
+   *
+   * @param v direction
+   * @param Hv receives hessian(x) * v
+   */
+  virtual void hessianVectorProduct(const TVector &x, const TVector &v, TVector &Hv) {
+    if (hasAnalyticGradient()) {
+      TVector grad(x.rows());
+      gradient(x, grad);
+      finiteHessianVectorProduct(x, grad, v, Hv);
+      return;
+    }
+    centralDifferenceHessianVectorProduct(x, v, Hv, [this](const TVector &xx, TVector &g) { gradient(xx, g); });
+  }
+
+  /**
+   * @brief forward difference of the gradient along v
+   * @details needs a single gradient evaluation when the gradient in x is known
+   *
+   * @param grad gradient in x
+   * @param v direction
+   * @param Hv receives approximately hessian(x) * v
+   */
+  void finiteHessianVectorProduct(const TVector &x, const TVector &grad, const TVector &v, TVector &Hv) {
+    forwardDifferenceHessianVectorProduct(x, grad, v, Hv, [this](const TVector &xx, TVector &g) { gradient(xx, g); });
   }
 
   virtual bool checkGradient(const TVector &x, int accuracy = 3) {
-    // TODO: check if derived class exists:
-    // int(typeid(&Rosenbrock<double>::gradient) == typeid(&Problem<double>::gradient)) == 1 --> overwritten
     const TIndex D = x.rows();
     TVector actual_grad(D);
     TVector expected_grad(D);
     gradient(x, actual_grad);
     finiteGradient(x, expected_grad, accuracy);
     for (TIndex d = 0; d < D; ++d) {
-      Scalar scale = std::max((std::max(fabs(actual_grad[d]), fabs(expected_grad[d]))), 1.);
+      Scalar scale = std::max(static_cast<Scalar>(std::max(fabs(actual_grad[d]), fabs(expected_grad[d]))), Scalar(1.));
       if(fabs(actual_grad[d]-expected_grad[d])>1e-2 * scale)
         return false;
     }
@@ -99,108 +248,141 @@ class Problem {
     return true;
   }
 
-  void finiteGradient(const  TVector &x, TVector &grad, int accuracy = 0) {
-    // accuracy can be 0, 1, 2, 3
-    const Scalar eps = 2.2204e-6;
-    static const std::array<std::vector<Scalar>, 4> coeff =
-    { { {1, -1}, {1, -8, 8, -1}, {-1, 9, -45, 45, -9, 1}, {3, -32, 168, -672, 672, -168, 32, -3} } };
-    static const std::array<std::vector<Scalar>, 4> coeff2 =
-    { { {1, -1}, {-2, -1, 1, 2}, {-3, -2, -1, 1, 2, 3}, {-4, -3, -2, -1, 1, 2, 3, 4} } };
-    static const std::array<Scalar, 4> dd = {2, 12, 60, 840};
-
-    grad.resize(x.rows());
-    TVector& xx = const_cast<TVector&>(x);
-
-    const int innerSteps = 2*(accuracy+1);
-    const Scalar ddVal = dd[accuracy]*eps;
-
-    for (TIndex d = 0; d < x.rows(); d++) {
-      grad[d] = 0;
-      for (int s = 0; s < innerSteps; ++s)
-      {
-        Scalar tmp = xx[d];
-        xx[d] += coeff2[accuracy][s]*eps;
-        grad[d] += coeff[accuracy][s]*value(xx);
-        xx[d] = tmp;
-      }
-      grad[d] /= ddVal;
+  /**
+   * @brief randomised gradient check along a few directions
+   * @details compares g^T v with a one dimensional finite difference of the objective
+   *          along v for `probes` random unit directions v. This costs one gradient and
+   *          2 (accuracy + 1) evaluations per probe instead of 2 (accuracy + 1) D
+   *          evaluations for checkGradient(). Errors are relative to max(|g^T v|, |fd|, 1).
+   *
+   * @param probes number of random directions
+   * @param accuracy stencil of the finite differences, 0 to 3
+   * @param errors if given, receives the error of every probe
+   * @param seed seed of the random directions
+   * @return largest error of all probes
+   */
+  Scalar directionalGradientError(const TVector &x, int probes = 4, int accuracy = 3,
+                                  std::vector<Scalar> *errors = nullptr, unsigned int seed = 0) {
+    using std::abs;
+    const Stencil &stencil = centralStencil(accuracy);
+    const Scalar eps = stencilStep(x);
+    TVector grad(x.rows());
+    gradient(x, grad);
+
+    std::mt19937 generator(seed);
+    TVector v(x.rows());
+    Scalar worst = 0;
+    if (errors)
+      errors->clear();
+    for (int k = 0; k < probes; ++k) {
+      randomDirection(generator, v);
+      Scalar sum = 0;
+      for (size_t s = 0; s < stencil.weights.size(); ++s)
+        sum += stencil.weights[s] * value(x + (stencil.offsets[s] * eps) * v);
+      const Scalar expected = sum / (stencil.denominator * eps);
+      const Scalar actual = grad.dot(v);
+      const Scalar error = abs(actual - expected) / std::max(std::max(abs(actual), abs(expected)), Scalar(1.));
+      worst = std::max(worst, error);
+      if (errors)
+        errors->push_back(error);
     }
+    return worst;
   }
 
-  void finiteHessian(const TVector &x, THessian &hessian, int accuracy = 0) {
-    const Scalar eps = std::numeric_limits<Scalar>::epsilon()*10e7;
-
-    hessian.resize(x.rows(), x.rows());
-    TVector& xx = const_cast<TVector&>(x);
-
-    if(accuracy == 0) {
-      for (TIndex i = 0; i < x.rows(); i++) {
-        for (TIndex j = 0; j < x.rows(); j++) {
-          Scalar tmpi = xx[i];
-          Scalar tmpj = xx[j];
-
-          Scalar f4 = value(xx);
-          xx[i] += eps;
-          xx[j] += eps;
-          Scalar f1 = value(xx);
-          xx[j] -= eps;
-          Scalar f2 = value(xx);
-          xx[j] += eps;
-          xx[i] -= eps;
-          Scalar f3 = value(xx);
-          hessian(i, j) = (f1 - f2 - f3 + f4) / (eps * eps);
-
-          xx[i] = tmpi;
-          xx[j] = tmpj;
-        }
+  /**
+   * @brief randomised hessian check along a few directions
+   * @details compares hessianVectorProduct() with a finite difference of the gradient
+   *          along `probes` random unit directions, at 2 (accuracy + 1) gradients per
+   *          probe. Errors are relative to max(|Hv|, |fd|, 1) in the euclidean norm.
+   *          The default hessianVectorProduct() is itself a difference of the gradient, so
+   *          a symbolic hessian() is only checked with withHessian. This forms the dense
+   *          hessian once and compares hessian() * v as well, the larger error is reported.
+   *
+   * @param probes number of random directions
+   * @param accuracy stencil of the finite differences, 0 to 3
+   * @param errors if given, receives the error of every probe
+   * @param seed seed of the random directions
+   * @param withHessian also check hessian(), O(D^2) memory
+   * @return largest error of all probes
+   */
+  Scalar directionalHessianError(const TVector &x, int probes = 4, int accuracy = 3,
+                                 std::vector<Scalar> *errors = nullptr, unsigned int seed = 0,
+                                 bool withHessian = false) {
+    const Stencil &stencil = centralStencil(accuracy);
+    const Scalar eps = stencilStep(x);
+    const TIndex D = x.rows();
+
+    THessian H;
+    if (withHessian) {
+      H.resize(D, D);
+      hessian(x, H);
+    }
+
+    std::mt19937 generator(seed);
+    TVector v(D), Hv(D), expected(D), grad(D);
+    Scalar worst = 0;
+    if (errors)
+      errors->clear();
+    for (int k = 0; k < probes; ++k) {
+      randomDirection(generator, v);
+      expected.setZero();
+      for (size_t s = 0; s < stencil.weights.size(); ++s) {
+        gradient(x + (stencil.offsets[s] * eps) * v, grad);
+        expected += stencil.weights[s] * grad;
       }
-    } else {
-      /*
-        \displaystyle{{\frac{\partial^2{f}}{\partial{x}\partial{y}}}\approx
-        \frac{1}{600\,h^2} \left[\begin{matrix}
-          -63(f_{1,-2}+f_{2,-1}+f_{-2,1}+f_{-1,2})+\\
-          63(f_{-1,-2}+f_{-2,-1}+f_{1,2}+f_{2,1})+\\
-          44(f_{2,-2}+f_{-2,2}-f_{-2,-2}-f_{2,2})+\\
-          74(f_{-1,-1}+f_{1,1}-f_{1,-1}-f_{-1,1})
-        \end{matrix}\right] }
-      */
-      for (TIndex i = 0; i < x.rows(); i++) {
-        for (TIndex j = 0; j < x.rows(); j++) {
-          Scalar tmpi = xx[i];
-          Scalar tmpj = xx[j];
-
-          Scalar term_1 = 0;
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += 1*eps;  xx[j] += -2*eps;  term_1 += value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += 2*eps;  xx[j] += -1*eps;  term_1 += value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += -2*eps; xx[j] += 1*eps;   term_1 += value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += -1*eps; xx[j] += 2*eps;   term_1 += value(xx);
-
-          Scalar term_2 = 0;
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += -1*eps; xx[j] += -2*eps;  term_2 += value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += -2*eps; xx[j] += -1*eps;  term_2 += value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += 1*eps;  xx[j] += 2*eps;   term_2 += value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += 2*eps;  xx[j] += 1*eps;   term_2 += value(xx);
-
-          Scalar term_3 = 0;
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += 2*eps;  xx[j] += -2*eps;  term_3 += value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += -2*eps; xx[j] += 2*eps;   term_3 += value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += -2*eps; xx[j] += -2*eps;  term_3 -= value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += 2*eps;  xx[j] += 2*eps;   term_3 -= value(xx);
-
-          Scalar term_4 = 0;
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += -1*eps; xx[j] += -1*eps;  term_4 += value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += 1*eps;  xx[j] += 1*eps;   term_4 += value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += 1*eps;  xx[j] += -1*eps;  term_4 -= value(xx);
-          xx[i] = tmpi; xx[j] = tmpj; xx[i] += -1*eps; xx[j] += 1*eps;   term_4 -= value(xx);
-
-          xx[i] = tmpi;
-          xx[j] = tmpj;
-
-          hessian(i, j) = (-63 * term_1+63 * term_2+44 * term_3+74 * term_4)/(600.0 * eps * eps);
-        }
+      expected /= stencil.denominator * eps;
+      hessianVectorProduct(x, v, Hv);
+      Scalar error = (Hv - expected).norm() / std::max(std::max(Hv.norm(), expected.norm()), Scalar(1.));
+      if (withHessian) {
+        Hv.noalias() = H * v;
+        error = std::max(error, (Hv - expected).norm() / std::max(std::max(Hv.norm(), expected.norm()), Scalar(1.)));
       }
+      worst = std::max(worst, error);
+      if (errors)
+        errors->push_back(error);
     }
+    return worst;
+  }
 
+  /**
+   * @brief central difference approximation of the gradient
+   * @details the perturbed points are evaluated through valueBatch()
+   *
+   * @param accuracy stencil, 0 to 3
+   */
+  void finiteGradient(const  TVector &x, TVector &grad, int accuracy = 0) {
+    finiteDifferenceGradient(x, grad, accuracy, m_threads,
+                             [this](const TBatch &X, TBatchValues &f) { valueBatch(X, f); });
+  }
+
+  /**
+   * @brief finite difference approximation of the hessian
+   * @details see finiteDifferenceHessian(), 1 + D + D(D+1)/2 evaluations for accuracy 0
+   *          and a 16-point stencil per entry otherwise. Evaluations are spread over
+   *          numThreads() threads.
+   */
+  void finiteHessian(const TVector &x, THessian &hessian, int accuracy = 0) {
+    const TIndex D = x.rows();
+    const int threads = static_cast<int>(std::min<TIndex>(m_threads, std::max<TIndex>(D * (D + 1) / 2, 1)));
+    std::vector<std::unique_ptr<Problem>> owned;
+    const std::vector<Problem *> problems = threadProblems(threads, owned);
+    finiteDifferenceHessian(x, hessian, accuracy, threads,
+                            [&](int t, const TVector &xx) { return problems[t]->value(xx); });
+  }
+
+  /**
+   * @brief finite difference approximation of the hessian from gradient differences
+   * @details uses D (accuracy 0, forward) or 2D (otherwise, central) calls of
+   *          gradient() and symmetrises the result. This is only worthwhile if the
+   *          gradient is not itself a finite difference approximation. Evaluations
+   *          are spread over numThreads() threads.
+   */
+  void finiteHessianFromGradient(const TVector &x, THessian &hessian, int accuracy = 0) {
+    const int threads = static_cast<int>(std::min<TIndex>(m_threads, std::max<TIndex>(x.rows(), 1)));
+    std::vector<std::unique_ptr<Problem>> owned;
+    const std::vector<Problem *> problems = threadProblems(threads, owned);
+    finiteDifferenceHessianFromGradient(x, hessian, accuracy, threads,
+                                        [&](int t, const TVector &xx, TVector &g) { problems[t]->gradient(xx, g); });
   }
 
 };
@@ -0,0 +1,69 @@
+// CppNumericalSolver
+#ifndef PROJECTION_H
+#define PROJECTION_H
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <Eigen/Core>
+
+namespace cppoptlib {
+
+/**
+ * @brief euclidean projection onto the simplex {x >= 0, sum x = radius}
+ * @details sorts v once and finds the threshold theta with sum max(v - theta, 0) = radius,
+ *          O(n log n) (Held, Wolfe and Crowder; Duchi et al. 2008)
+ *
+ * @param v point to project
+ * @param radius sum of the projected entries, positive
+ * @param x receives the projection, may alias v
+ */
+template<typename TVector>
+void projectOntoSimplex(const TVector &v, typename TVector::Scalar radius, TVector &x) {
+  using Scalar = typename TVector::Scalar;
+  const Eigen::DenseIndex n = v.rows();
+  std::vector<Scalar> u(v.data(), v.data() + n);
+  std::sort(u.begin(), u.end(), std::greater<Scalar>());
+  Scalar sum = 0, theta = 0;
+  for (Eigen::DenseIndex j = 0; j < n; ++j) {
+    sum += u[j];
+    const Scalar candidate = (sum - radius) / Scalar(j + 1);
+    // the entries down to the last positive one stay in the support
+    if (u[j] > candidate)
+      theta = candidate;
+  }
+  x = (v.array() - theta).cwiseMax(Scalar(0));
+}
+
+/**
+ * @brief euclidean projection onto the l1 ball {||x||_1 <= radius}
+ * @details points inside are returned unchanged, otherwise the magnitudes are projected
+ *          onto the simplex of the given radius and the signs restored, O(n log n)
+ *
+ * @param v point to project
+ * @param radius radius of the ball, positive
+ * @param x receives the projection, may alias v
+ */
+template<typename TVector>
+void projectOntoL1Ball(const TVector &v, typename TVector::Scalar radius, TVector &x) {
+  if (v.template lpNorm<1>() <= radius) {
+    x = v;
+    return;
+  }
+  const TVector sign = v.array().sign();
+  TVector magnitude = v.cwiseAbs();
+  projectOntoSimplex(magnitude, radius, magnitude);
+  x = sign.cwiseProduct(magnitude);
+}
+
+/**
+ * @brief euclidean projection onto the box {lower <= x <= upper}
+ */
+template<typename TVector>
+void projectOntoBox(const TVector &v, const TVector &lower, const TVector &upper, TVector &x) {
+  x = v.cwiseMax(lower).cwiseMin(upper);
+}
+
+} // end namespace cppoptlib
+
+#endif // PROJECTION_H
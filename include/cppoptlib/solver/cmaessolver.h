@@ -147,22 +147,25 @@ class CMAesSolver : public ISolver<ProblemType, 1> {
     Scalar bestCostSoFar;
 
     TVector zeroVectorTemplate = TVector::Zero(DIM);
+    typename ProblemType::TBatch population(DIM, populationSize);
+    typename ProblemType::TBatchValues costs;
 
     // CMA-ES Main Loop
     for (size_t curIter = 0; curIter < this->m_stop.iterations; ++curIter) {
-      std::vector<individual> pop;
+      std::vector<individual> pop(populationSize);
 
+      // sample the whole population first and evaluate it as one batch
       for (int i = 0; i < populationSize; ++i) {
-        individual curInd;
-        curInd.step = sampleMvn(zeroVectorTemplate, C).eval();
-        curInd.pos = M.pos + sigma * curInd.step;
-        curInd.cost = objFunc(curInd.pos);
-
-        if (curInd.cost < bestSol.cost) {
-          bestSol = curInd;
+        pop[i].step = sampleMvn(zeroVectorTemplate, C).eval();
+        pop[i].pos = M.pos + sigma * pop[i].step;
+        population.col(i) = pop[i].pos;
+      }
+      objFunc.valueBatch(population, costs);
+      for (int i = 0; i < populationSize; ++i) {
+        pop[i].cost = costs[i];
+        if (pop[i].cost < bestSol.cost) {
+          bestSol = pop[i];
         }
-        pop.push_back(curInd);
-
       }
 
       // sort them according their fitness
@@ -238,6 +241,7 @@ class CMAesSolver : public ISolver<ProblemType, 1> {
       if(!objFunc.callback(this->m_current, x0))
         break;
     }
+    this->recordEvaluations(objFunc);
   }
 
 };
@@ -51,7 +51,7 @@ class ConjugatedGradientDescentSolver : public ISolver<ProblemType, 1> {
       ++this->m_current.iterations;
       this->m_status = checkConvergence(this->m_stop, this->m_current);
     } while (objFunc.callback(this->m_current, x0) && (this->m_status == Status::Continue) );
-
+    this->recordEvaluations(objFunc);
   }
 
 };
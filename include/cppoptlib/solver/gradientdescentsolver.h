@@ -36,6 +36,7 @@ public:
       ++this->m_current.iterations;
       this->m_status = checkConvergence(this->m_stop, this->m_current);
     } while (objFunc.callback(this->m_current, x0) && (this->m_status == Status::Continue));
+    this->recordEvaluations(objFunc);
     if (this->m_debug > DebugLevel::None) {
         std::cout << "Stop status was: " << this->m_status << std::endl;
         std::cout << "Stop criteria were: " << std::endl << this->m_stop << std::endl;
@@ -6,6 +6,7 @@
 #include "isolver.h"
 #include "../meta.h"
 #include "../problem.h"
+#include "../statistics.h"
 
 namespace cppoptlib {
 
@@ -21,6 +22,20 @@ protected:
     TCriteria m_stop, m_current;
     Status m_status = Status::NotStarted;
     DebugLevel m_debug = DebugLevel::None;
+    EvaluationStatistics m_evaluations;
+
+    /**
+     * @brief copies the statistics of an InstrumentedProblem at the end of minimize()
+     * @details problems without statistics() leave them empty
+     */
+    template<typename P>
+    void recordEvaluations(const P &problem) { recordEvaluations(problem, 0); }
+    template<typename P>
+    auto recordEvaluations(const P &problem, int) -> decltype(problem.statistics(), void()) {
+        m_evaluations = problem.statistics();
+    }
+    template<typename P>
+    void recordEvaluations(const P &, long) { m_evaluations = EvaluationStatistics(); }
 
 public:
     virtual ~ISolver() = default;
@@ -38,6 +53,7 @@ public:
     const TCriteria &criteria() { return m_current; }
     const Status &status() { return m_status; }
     void setDebug(const DebugLevel &d) { m_debug = d; }
+    const EvaluationStatistics &evaluations() const { return m_evaluations; }
 
     /**
      * @brief minimize an objective function given a gradient (and optinal a hessian)
@@ -1,6 +1,9 @@
 // CppNumericalSolver
 #include <iostream>
-#include <list>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <Eigen/Cholesky>
 #include <Eigen/LU>
 #include "isolver.h"
 #include "../boundedproblem.h"
@@ -17,89 +20,134 @@ class LbfgsbSolver : public ISolver<TProblem, 1> {
     using MatrixType = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
     using VariableTVector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
   protected:
-  // last updates
-  std::list<TVector> xHistory;
-  // workspace matrices
+  // compact representation B = theta I - W M W^T of the limited memory matrix. W holds
+  // the pairs y_i in its first m columns and s_i in its last m columns, both circular,
+  // and M already contains the scaling by theta (Byrd, Lu, Nocedal and Zhu 1995).
   MatrixType W, M;
   Scalar theta;
   int DIM;
   int m_historySize = 5;
+  // S^T Y and S^T S of the stored pairs, updated one row and column per new pair
+  MatrixType SY, SS;
+  // workspace of the middle matrix: L / theta, its product with D^-1, the schur
+  // complement of -D and the inverse of the latter
+  MatrixType m_lower, m_lowerDinv, m_schur, m_schurInverse, m_identity;
+  VariableTVector m_dInverse;
+  Eigen::LDLT<MatrixType> m_schurFactor;
+  // insertion count of the pair in each slot, to order the pairs in time
+  std::vector<long> m_stamp;
+  int m_numPairs, m_newest;
+  long m_numUpdates;
+  // workspace of the cauchy point: heap of breakpoints, direction and products with M
+  std::vector<std::pair<Scalar, int> > m_breakpoints;
+  TVector d;
+  VariableTVector p, wbt, Mc, Mp, Mw;
+  // workspace of the subspace minimization, sized for all variables free: rows of W of
+  // the free variables, reduced gradient, step and the 2m x 2m system with its factors
+  std::vector<int> m_free;
+  MatrixType m_WZ, m_WZZW, m_N;
+  TVector m_reducedGradient, m_du;
+  VariableTVector m_v, m_Mv;
+  Eigen::PartialPivLU<MatrixType> m_nFactor;
 
   /**
-   * @brief sort pairs (k,v) according v ascending
-   * @details [long description]
-   *
-   * @param v [description]
-   * @return [description]
+   * @brief stores a new pair in place of the oldest and updates the compact form
+   * @details O(mn) for the new row and column of S^T Y and S^T S, O(m^3) for the
+   *          middle matrix. M is the inverse of [[-D, L^T / theta], [L / theta, S^T S / theta]]
+   *          and is computed blockwise from the LDL^T factorisation of the schur complement
+   *          K = S^T S / theta + L D^-1 L^T / theta^2 of -D. Slots without a pair have zero
+   *          columns in W and decouple from the others.
    */
-  std::vector<int> sort_indexes(const std::vector< std::pair<int, Scalar> > &v) {
-    std::vector<int> idx(v.size());
-    for (size_t i = 0; i != idx.size(); ++i)
-      idx[i] = v[i].first;
-    sort(idx.begin(), idx.end(), [&v](size_t i1, size_t i2) {
-      return v[i1].second < v[i2].second;
-    });
-    return idx;
+  void updateHistory(const TVector &newS, const TVector &newY) {
+    const int m = m_historySize;
+    m_newest = (m_newest + 1) % m;
+    m_numPairs = std::min(m_numPairs + 1, m);
+    m_stamp[m_newest] = m_numUpdates++;
+    const int j = m_newest;
+    W.col(j) = newY;
+    W.col(m + j) = newS;
+    SY.row(j).noalias() = newS.transpose() * W.leftCols(m);
+    SY.col(j).noalias() = W.rightCols(m).transpose() * newY;
+    SS.col(j).noalias() = W.rightCols(m).transpose() * newS;
+    SS.row(j) = SS.col(j).transpose();
+
+    theta = newY.squaredNorm() / newY.dot(newS);
+    for (int a = 0; a < m; ++a) {
+      const bool used = a < m_numPairs;
+      m_dInverse(a) = used ? 1 / SY(a, a) : Scalar(1);
+      for (int b = 0; b < m; ++b)
+        m_lower(a, b) = (used && (m_stamp[a] > m_stamp[b])) ? SY(a, b) / theta : Scalar(0);
+    }
+    m_lowerDinv.noalias() = m_lower * m_dInverse.asDiagonal();
+    m_schur = SS / theta;
+    m_schur.noalias() += m_lowerDinv * m_lower.transpose();
+    for (int a = m_numPairs; a < m; ++a)
+      m_schur(a, a) = 1;
+    m_schurFactor.compute(m_schur);
+    m_schurInverse = m_schurFactor.solve(m_identity);
+
+    // inverse of [[A, B], [C, E]] with A = -D, B = C^T = L^T / theta, E = S^T S / theta
+    M.bottomRightCorner(m, m) = m_schurInverse;
+    M.bottomLeftCorner(m, m).noalias() = m_schurInverse * m_lowerDinv;
+    M.topRightCorner(m, m) = M.bottomLeftCorner(m, m).transpose();
+    M.topLeftCorner(m, m).noalias() = m_lowerDinv.transpose() * M.bottomLeftCorner(m, m);
+    M.topLeftCorner(m, m).diagonal() -= m_dInverse;
   }
+
   /**
    * @brief Algorithm CP: Computation of the generalized Cauchy point
-   * @details PAGE 8
+   * @details PAGE 8. The breakpoints t_i > 0 are kept in a binary min-heap, built in O(n),
+   *          and only the breakpoints of the examined segments are popped, O(log n) each.
+   *          Typically few segments are examined, so the cost is about O(n) instead of
+   *          sorting all breakpoints. Variables with t_i = 0 do not move.
    *
    * @param c [description]
    */
   void getGeneralizedCauchyPoint(const TProblem &problem, TVector &x, TVector &g, TVector &x_cauchy, VariableTVector &c) {
     const int DIM = x.rows();
     // Given x,l,u,g, and B = \theta I-WMW
-    // {all t_i} = { (idx,value), ... }
-    // TODO: use "std::set" ?
-    std::vector<std::pair<int, Scalar> > SetOfT;
-    // the feasible set is implicitly given by "SetOfT - {t_i==0}"
-    TVector d = -g;
+    // breakpoints (t_i, i) of all variables that reach a bound along d
+    std::vector<std::pair<Scalar, int> > &heap = m_breakpoints;
+    heap.clear();
+    d = -g;
     // n operations
     for (int j = 0; j < DIM; j++) {
-      if (g(j) == 0) {
-        SetOfT.push_back(std::make_pair(j, std::numeric_limits<Scalar>::max()));
-      } else {
-        Scalar tmp = 0;
-        if (g(j) < 0) {
-          tmp = (x(j) - problem.upperBound()(j)) / g(j);
-        } else {
-          tmp = (x(j) - problem.lowerBound()(j)) / g(j);
-        }
-        SetOfT.push_back(std::make_pair(j, tmp));
-      }
+      Scalar t = std::numeric_limits<Scalar>::infinity();
+      if (g(j) < 0)
+        t = (x(j) - problem.upperBound()(j)) / g(j);
+      else if (g(j) > 0)
+        t = (x(j) - problem.lowerBound()(j)) / g(j);
+      if (t <= 0)
+        d(j) = 0;
+      else if (t < std::numeric_limits<Scalar>::infinity())
+        heap.push_back(std::make_pair(t, j));
     }
-    // sortedindices [1,0,2] means the minimal element is on the 1-st entry
-    std::vector<int> sortedIndices = sort_indexes(SetOfT);
+    const auto later = [](const std::pair<Scalar, int> &a, const std::pair<Scalar, int> &b) {
+      return a.first > b.first;
+    };
+    std::make_heap(heap.begin(), heap.end(), later);
     x_cauchy = x;
     // Initialize
     // p :=     W^Scalar*p
-    VariableTVector p = (W.transpose() * d);                     // (2mn operations)
+    p.noalias() = W.transpose() * d;                    // (2mn operations)
     // c :=     0
-    c = VariableTVector::Zero(W.cols());
+    c.setZero(W.cols());
     // f' :=    g^Scalar*d = -d^Td
     Scalar f_prime = -d.dot(d);                         // (n operations)
     // f'' :=   \theta*d^Scalar*d-d^Scalar*W*M*W^Scalar*d = -\theta*f' - p^Scalar*M*p
-    Scalar f_doubleprime = (Scalar)(-1.0 * theta) * f_prime - p.dot(M * p); // (O(m^2) operations)
+    Mp.noalias() = M * p;
+    Scalar f_doubleprime = (Scalar)(-1.0 * theta) * f_prime - p.dot(Mp); // (O(m^2) operations)
     // \delta t_min :=  -f'/f''
     Scalar dt_min = -f_prime / f_doubleprime;
     // t_old :=     0
     Scalar t_old = 0;
-    // b :=     argmin {t_i , t_i >0}
-    int i = 0;
-    for (int j = 0; j < DIM; j++) {
-      i = j;
-      if (SetOfT[sortedIndices[j]].second > 0)
-        break;
-    }
-    int b = sortedIndices[i];
-    // see below
-    // t                    :=  min{t_i : i in F}
-    Scalar t = SetOfT[b].second;
-    // \delta Scalar             :=  t - 0
-    Scalar dt = t ;
-    // examination of subsequent segments
-    while ((dt_min >= dt) && (i < DIM)) {
+    // examination of subsequent segments, b := argmin {t_i , t_i >0}
+    while (!heap.empty() && (dt_min >= heap.front().first - t_old)) {
+      std::pop_heap(heap.begin(), heap.end(), later);
+      const Scalar t = heap.back().first;
+      const int b = heap.back().second;
+      heap.pop_back();
+      const Scalar dt = t - t_old;
       if (d(b) > 0)
         x_cauchy(b) = problem.upperBound()(b);
       else if (d(b) < 0)
@@ -109,28 +157,26 @@ class LbfgsbSolver : public ISolver<TProblem, 1> {
       // c   :=  c +\delta t*p
       c += dt * p;
       // cache
-      VariableTVector wbt = W.row(b);
+      wbt = W.row(b).transpose();
+      Mc.noalias() = M * c;
+      Mp.noalias() = M * p;
+      Mw.noalias() = M * wbt;
       f_prime += dt * f_doubleprime + (Scalar) g(b) * g(b) + (Scalar) theta * g(b) * zb - (Scalar) g(b) *
-      wbt.transpose() * (M * c);
+      wbt.dot(Mc);
       f_doubleprime += (Scalar) - 1.0 * theta * g(b) * g(b)
-                       - (Scalar) 2.0 * (g(b) * (wbt.dot(M * p)))
-                       - (Scalar) g(b) * g(b) * wbt.transpose() * (M * wbt);
-      p += g(b) * wbt.transpose();
+                       - (Scalar) 2.0 * (g(b) * (wbt.dot(Mp)))
+                       - (Scalar) g(b) * g(b) * wbt.dot(Mw);
+      p += g(b) * wbt;
       d(b) = 0;
       dt_min = -f_prime / f_doubleprime;
       t_old = t;
-      ++i;
-      if (i < DIM) {
-        b = sortedIndices[i];
-        t = SetOfT[b].second;
-        dt = t - t_old;
-      }
     }
     dt_min = std::max(dt_min, (Scalar)0.0);
     t_old += dt_min;
-    #pragma omp parallel for
-    for (int ii = i; ii < x_cauchy.rows(); ii++) {
-      x_cauchy(sortedIndices[ii]) = x(sortedIndices[ii]) + t_old * d(sortedIndices[ii]);
+    // variables not fixed at a bound move along d
+    for (int j = 0; j < DIM; j++) {
+      if (d(j) != 0)
+        x_cauchy(j) = x(j) + t_old * d(j);
     }
     c += dt_min * p;
   }
@@ -141,10 +187,10 @@ class LbfgsbSolver : public ISolver<TProblem, 1> {
    * @param FreeVariables [description]
    * @return [description]
    */
-  Scalar findAlpha(const TProblem &problem, TVector &x_cp, VariableTVector &du, std::vector<int> &FreeVariables) {
+  Scalar findAlpha(const TProblem &problem, TVector &x_cp, const TVector &du, std::vector<int> &FreeVariables) {
     Scalar alphastar = 1;
     const unsigned int n = FreeVariables.size();
-    assert(du.rows() == n);
+    assert(du.rows() >= n);
     for (unsigned int i = 0; i < n; i++) {
       if (du(i) > 0) {
         alphastar = std::min(alphastar, (problem.upperBound()(FreeVariables[i]) - x_cp(FreeVariables[i])) / du(i));
@@ -163,56 +209,86 @@ class LbfgsbSolver : public ISolver<TProblem, 1> {
   void SubspaceMinimization(const TProblem &problem, TVector &x_cauchy, TVector &x, VariableTVector &c, TVector &g,
   TVector &SubspaceMin) {
     Scalar theta_inverse = 1 / theta;
-    std::vector<int> FreeVariablesIndex;
+    m_free.clear();
     for (int i = 0; i < x_cauchy.rows(); i++) {
       if ((x_cauchy(i) != problem.upperBound()(i)) && (x_cauchy(i) != problem.lowerBound()(i))) {
-        FreeVariablesIndex.push_back(i);
+        m_free.push_back(i);
       }
     }
-    const int FreeVarCount = FreeVariablesIndex.size();
-    MatrixType WZ = MatrixType::Zero(W.cols(), FreeVarCount);
+    const int FreeVarCount = m_free.size();
+    auto WZ = m_WZ.leftCols(FreeVarCount);
     for (int i = 0; i < FreeVarCount; i++)
-      WZ.col(i) = W.row(FreeVariablesIndex[i]);
-    TVector rr = (g + theta * (x_cauchy - x) - W * (M * c));
-    // r=r(FreeVariables);
-    MatrixType r = MatrixType::Zero(FreeVarCount, 1);
+      WZ.col(i) = W.row(m_free[i]).transpose();
+    // r = (g + theta*(x_cauchy - x) - W*M*c)(FreeVariables)
+    m_Mv.noalias() = M * c;
+    m_du = g + theta * (x_cauchy - x);
+    m_du.noalias() -= W * m_Mv;
+    auto r = m_reducedGradient.head(FreeVarCount);
     for (int i = 0; i < FreeVarCount; i++)
-      r.row(i) = rr.row(FreeVariablesIndex[i]);
+      r(i) = m_du(m_free[i]);
     // STEP 2: "v = w^T*Z*r" and STEP 3: "v = M*v"
-    VariableTVector v = M * (WZ * r);
+    m_Mv.noalias() = WZ * r;
+    m_v.noalias() = M * m_Mv;
     // STEP 4: N = 1/theta*W^T*Z*(W^T*Z)^T
-    MatrixType N = theta_inverse * WZ * WZ.transpose();
+    m_WZZW.noalias() = theta_inverse * WZ * WZ.transpose();
     // N = I - MN
-    N = MatrixType::Identity(N.rows(), N.rows()) - M * N;
+    m_N.setIdentity();
+    m_N.noalias() -= M * m_WZZW;
     // STEP: 5
     // v = N^{-1}*v
-    v = N.lu().solve(v);
+    m_nFactor.compute(m_N);
+    m_Mv = m_nFactor.solve(m_v);
     // STEP: 6
     // HERE IS A MISTAKE IN THE ORIGINAL PAPER!
-    VariableTVector du = -theta_inverse * r - theta_inverse * theta_inverse * WZ.transpose() * v;
+    auto du = m_du.head(FreeVarCount);
+    du = -theta_inverse * r;
+    du.noalias() -= theta_inverse * theta_inverse * WZ.transpose() * m_Mv;
     // STEP: 7
-    Scalar alpha_star = findAlpha(problem, x_cauchy, du, FreeVariablesIndex);
+    Scalar alpha_star = findAlpha(problem, x_cauchy, m_du, m_free);
     // STEP: 8
-    VariableTVector dStar = alpha_star * du;
     SubspaceMin = x_cauchy;
     for (int i = 0; i < FreeVarCount; i++) {
-      SubspaceMin(FreeVariablesIndex[i]) = SubspaceMin(FreeVariablesIndex[i]) + dStar(i);
+      SubspaceMin(m_free[i]) = SubspaceMin(m_free[i]) + alpha_star * du(i);
     }
   }
  public:
-  void setHistorySize(const int hs) { m_historySize = hs; }
+  /**
+   * @brief number of correction pairs kept, 5 by default, at least 1
+   */
+  void setHistorySize(const int hs) { m_historySize = std::max(hs, 1); }
 
   void minimize(TProblem &problem, TVector &x0) {
     DIM = x0.rows();
+    const int m = m_historySize;
     theta = 1.0;
-    W = MatrixType::Zero(DIM, 0);
-    M = MatrixType::Zero(0, 0);
-    xHistory.push_back(x0);
-    MatrixType yHistory = MatrixType::Zero(DIM, 0);
-    MatrixType sHistory = MatrixType::Zero(DIM, 0);
-    TVector x = x0, g = x0;
-    Scalar f = problem.value(x);
-    problem.gradient(x, g);
+    W = MatrixType::Zero(DIM, 2 * m);
+    M = MatrixType::Zero(2 * m, 2 * m);
+    SY = MatrixType::Zero(m, m);
+    SS = MatrixType::Zero(m, m);
+    m_lower = MatrixType::Zero(m, m);
+    m_lowerDinv = MatrixType::Zero(m, m);
+    m_schur = MatrixType::Zero(m, m);
+    m_schurInverse = MatrixType::Zero(m, m);
+    m_identity = MatrixType::Identity(m, m);
+    m_dInverse = VariableTVector::Ones(m);
+    m_schurFactor = Eigen::LDLT<MatrixType>(m);
+    m_stamp.assign(m, -1);
+    m_numPairs = 0;
+    m_newest = m - 1;
+    m_numUpdates = 0;
+    m_breakpoints.reserve(DIM);
+    d = TVector::Zero(DIM);
+    p = wbt = Mc = Mp = Mw = VariableTVector::Zero(2 * m);
+    m_free.reserve(DIM);
+    m_WZ = MatrixType::Zero(2 * m, DIM);
+    m_WZZW = m_N = MatrixType::Zero(2 * m, 2 * m);
+    m_reducedGradient = m_du = TVector::Zero(DIM);
+    m_v = m_Mv = VariableTVector::Zero(2 * m);
+    m_nFactor = Eigen::PartialPivLU<MatrixType>(2 * m);
+    TVector x = x0, g = x0, x_old = x0, g_old = x0, newS = x0, newY = x0;
+    TVector CauchyPoint = TVector::Zero(DIM), SubspaceMin = TVector::Zero(DIM), searchDir = TVector::Zero(DIM);
+    VariableTVector c = VariableTVector::Zero(2 * m);
+    Scalar f = problem.valueAndGradient(x, g);
     // conv. crit.
     auto noConvergence =
     [&](TVector &x, TVector &g)->bool {
@@ -222,49 +298,26 @@ class LbfgsbSolver : public ISolver<TProblem, 1> {
     this->m_status = Status::Continue;
     while (problem.callback(this->m_current, x) && noConvergence(x, g) && (this->m_status == Status::Continue)) {
       Scalar f_old = f;
-      TVector x_old = x;
-      TVector g_old = g;
+      x_old = x;
+      g_old = g;
       // STEP 2: compute the cauchy point
-      TVector CauchyPoint = TVector::Zero(DIM);
-      VariableTVector c = VariableTVector::Zero(W.cols());
       getGeneralizedCauchyPoint(problem, x, g, CauchyPoint, c);
       // STEP 3: compute a search direction d_k by the primal method for the sub-problem
-      TVector SubspaceMin;
       SubspaceMinimization(problem, CauchyPoint, x, c, g, SubspaceMin);
       // STEP 4: perform linesearch and STEP 5: compute gradient
       Scalar alpha_init = 1.0;
-      const Scalar rate = MoreThuente<TProblem, 1>::linesearch(x,  SubspaceMin-x ,  problem, alpha_init);
+      searchDir = SubspaceMin - x;
+      const Scalar rate = MoreThuente<TProblem, 1>::linesearch(x, searchDir, problem, alpha_init);
       // update current guess and function information
-      x = x - rate*(x-SubspaceMin);
-      f = problem.value(x);
-      problem.gradient(x, g);
-      xHistory.push_back(x);
+      x.noalias() += rate * searchDir;
+      f = problem.valueAndGradient(x, g);
       // prepare for next iteration
-      TVector newY = g - g_old;
-      TVector newS = x - x_old;
-      // STEP 6:
-      Scalar test = newS.dot(newY);
-      test = (test < 0) ? -1.0 * test : test;
-      if (test > 1e-7 * newY.squaredNorm()) {
-        if (yHistory.cols() < m_historySize) {
-          yHistory.conservativeResize(DIM, this->m_current.iterations + 1);
-          sHistory.conservativeResize(DIM, this->m_current.iterations + 1);
-        } else {
-          yHistory.leftCols(m_historySize - 1) = yHistory.rightCols(m_historySize - 1).eval();
-          sHistory.leftCols(m_historySize - 1) = sHistory.rightCols(m_historySize - 1).eval();
-        }
-        yHistory.rightCols(1) = newY;
-        sHistory.rightCols(1) = newS;
+      newY = g - g_old;
+      newS = x - x_old;
+      // STEP 6: only pairs of positive curvature keep the middle matrix well defined
+      if (newS.dot(newY) > 1e-7 * newY.squaredNorm()) {
         // STEP 7:
-        theta = (Scalar)(newY.transpose() * newY) / (newY.transpose() * newS);
-        W = MatrixType::Zero(yHistory.rows(), yHistory.cols() + sHistory.cols());
-        W << yHistory, (theta * sHistory);
-        MatrixType A = sHistory.transpose() * yHistory;
-        MatrixType L = A.template triangularView<Eigen::StrictlyLower>();
-        MatrixType MM(A.rows() + L.rows(), A.rows() + L.cols());
-        MatrixType D = -1 * A.diagonal().asDiagonal();
-        MM << D, L.transpose(), L, ((sHistory.transpose() * sHistory) * theta);
-        M = MM.inverse();
+        updateHistory(newS, newY);
       }
       if (fabs(f_old - f) < 1e-8) {
         // successive function values too similar
@@ -275,6 +328,7 @@ class LbfgsbSolver : public ISolver<TProblem, 1> {
       this->m_status = checkConvergence(this->m_stop, this->m_current);
     }
     x0 = x;
+    this->recordEvaluations(problem);
     if (this->m_debug > DebugLevel::None) {
         std::cout << "Stop status was: " << this->m_status << std::endl;
         std::cout << "Stop criteria were: " << std::endl << this->m_stop << std::endl;
@@ -1,5 +1,6 @@
 // CppNumericalSolver
 #include <iostream>
+#include <limits>
 #include <Eigen/LU>
 #include "isolver.h"
 #include "../linesearch/morethuente.h"
@@ -9,7 +10,22 @@
 
 namespace cppoptlib {
 
-template<typename ProblemType>
+/**
+ * @brief limited memory BFGS
+ * @details the last effectiveHistorySize() pairs s_i = x_{i+1} - x_i, y_i = g_{i+1} - g_i
+ *          are kept in a circular buffer together with rho_i = 1 / (s_i^T y_i). A new pair
+ *          overwrites the oldest one, so an iteration touches every stored vector only in the
+ *          two-loop recursion and allocates no memory after the first one.
+ *
+ *          The pairs can be stored in a lower precision than the problem's scalar, e.g.
+ *          LbfgsSolver<Problem, float> for a double problem. All arithmetic stays in the
+ *          problem's precision, only the stored vectors are rounded. This halves the memory
+ *          and the memory traffic of the recursion. With setMemoryBudget() the history size
+ *          is chosen from the number of bytes the pairs may occupy.
+ *
+ * @tparam HistoryScalar scalar type of the stored pairs
+ */
+template<typename ProblemType, typename HistoryScalar = typename ProblemType::Scalar>
 class LbfgsSolver : public ISolver<ProblemType, 1> {
   public:
     using Superclass = ISolver<ProblemType, 1>;
@@ -17,19 +33,55 @@ class LbfgsSolver : public ISolver<ProblemType, 1> {
     using typename Superclass::TVector;
     using typename Superclass::THessian;
     using MatrixType = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+    using VectorType = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+    using HistoryType = Eigen::Matrix<HistoryScalar, Eigen::Dynamic, Eigen::Dynamic>;
+
+  protected:
+    int m_historySize = 10;
+    size_t m_memoryBudget = 0;
+
+  public:
+    /**
+     * @brief number of correction pairs kept, 10 by default
+     * @details clears the memory budget
+     */
+    void setHistorySize(int m) {
+        m_historySize = std::max(m, 1);
+        m_memoryBudget = 0;
+    }
+    int historySize() const { return m_historySize; }
+
+    /**
+     * @brief bytes the stored pairs may occupy, replaces the history size if nonzero
+     * @details a problem of dimension n gets m = budget / (2 n sizeof(HistoryScalar)) pairs,
+     *          at least one. historySize() is then unused, see effectiveHistorySize().
+     */
+    void setMemoryBudget(size_t bytes) { m_memoryBudget = bytes; }
+    size_t memoryBudget() const { return m_memoryBudget; }
+
+    /**
+     * @brief number of pairs actually used for a problem of dimension n
+     */
+    int effectiveHistorySize(size_t n) const {
+        if (m_memoryBudget == 0)
+            return m_historySize;
+        const size_t pairBytes = 2 * std::max<size_t>(n, 1) * sizeof(HistoryScalar);
+        return static_cast<int>(std::max<size_t>(std::min<size_t>(m_memoryBudget / pairBytes, std::numeric_limits<int>::max()), 1));
+    }
 
     void minimize(ProblemType &objFunc, TVector &x0) {
-        const size_t m = 10;
         const size_t DIM = x0.rows();
-        MatrixType sVector = MatrixType::Zero(DIM, m);
-        MatrixType yVector = MatrixType::Zero(DIM, m);
-        Eigen::Matrix<Scalar, Eigen::Dynamic, 1> alpha = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>::Zero(m);
-        TVector grad(DIM), q(DIM), grad_old(DIM), s(DIM), y(DIM);
+        const int m = effectiveHistorySize(DIM);
+        HistoryType sVector = HistoryType::Zero(DIM, m);
+        HistoryType yVector = HistoryType::Zero(DIM, m);
+        VectorType rho = VectorType::Zero(m);
+        VectorType alpha = VectorType::Zero(m);
+        TVector grad(DIM), q(DIM), grad_old(DIM), searchDir(DIM);
         objFunc.gradient(x0, grad);
         TVector x_old = x0;
-        TVector x_old2 = x0;
 
-        size_t iter = 0, globIter = 0;
+        // number of stored pairs and column of the newest one
+        int k = 0, newest = m - 1;
         Scalar H0k = 1;
         this->m_current.reset();
         do {
@@ -40,27 +92,22 @@ class LbfgsSolver : public ISolver<ProblemType, 1> {
 
             //Algorithm 7.4 (L-BFGS two-loop recursion)
             q = grad;
-            const int k = std::min(m, iter);
 
-            // for i = k − 1, k − 2, . . . , k − m§
-            for (int i = k - 1; i >= 0; i--) {
+            // from the newest to the oldest pair
+            for (int j = 0, i = newest; j < k; ++j, i = (i + m - 1) % m) {
                 // alpha_i <- rho_i*s_i^T*q
-                const double rho = 1.0 / static_cast<TVector>(sVector.col(i))
-                .dot(static_cast<TVector>(yVector.col(i)));
-                alpha(i) = rho * static_cast<TVector>(sVector.col(i)).dot(q);
+                alpha(i) = rho(i) * sVector.col(i).template cast<Scalar>().dot(q);
                 // q <- q - alpha_i*y_i
-                q = q - alpha(i) * yVector.col(i);
+                q.noalias() -= alpha(i) * yVector.col(i).template cast<Scalar>();
             }
             // r <- H_k^0*q
-            q = H0k * q;
-            //for i k − m, k − m + 1, . . . , k − 1
-            for (int i = 0; i < k; i++) {
+            q *= H0k;
+            // from the oldest to the newest pair
+            for (int j = 0, i = (newest + m - k + 1) % m; j < k; ++j, i = (i + 1) % m) {
                 // beta <- rho_i * y_i^T * r
-                const Scalar rho = 1.0 / static_cast<TVector>(sVector.col(i))
-                .dot(static_cast<TVector>(yVector.col(i)));
-                const Scalar beta = rho * static_cast<TVector>(yVector.col(i)).dot(q);
+                const Scalar beta = rho(i) * yVector.col(i).template cast<Scalar>().dot(q);
                 // r <- r + s_i * ( alpha_i - beta)
-                q = q + sVector.col(i) * (alpha(i) - beta);
+                q.noalias() += (alpha(i) - beta) * sVector.col(i).template cast<Scalar>();
             }
             // stop with result "H_k*f_f'=q"
 
@@ -68,47 +115,41 @@ class LbfgsSolver : public ISolver<ProblemType, 1> {
             Scalar descent = -grad.dot(q);
             Scalar alpha_init =  1.0 / grad.norm();
             if (descent > -0.0001 * relativeEpsilon) {
-                q = -1 * grad;
-                iter = 0;
+                q = grad;
+                k = 0;
                 alpha_init = 1.0;
             }
 
             // find steplength
-            const Scalar rate = MoreThuente<ProblemType, 1>::linesearch(x0, -q,  objFunc, alpha_init) ;
+            searchDir = -q;
+            const Scalar rate = MoreThuente<ProblemType, 1>::linesearch(x0, searchDir, objFunc, alpha_init) ;
             // update guess
-            x0 = x0 - rate * q;
+            x0.noalias() += rate * searchDir;
 
-            grad_old = grad;
+            grad_old.swap(grad);
             objFunc.gradient(x0, grad);
 
-            s = x0 - x_old;
-            y = grad - grad_old;
-
-            // update the history
-            if (iter < m) {
-                sVector.col(iter) = s;
-                yVector.col(iter) = y;
-            } else {
+            // the newest pair replaces the oldest one
+            newest = (newest + 1) % m;
+            sVector.col(newest) = (x0 - x_old).template cast<HistoryScalar>();
+            yVector.col(newest) = (grad - grad_old).template cast<HistoryScalar>();
+            // curvature of the stored, possibly rounded pair keeps the recursion consistent
+            const Scalar ys = yVector.col(newest).template cast<Scalar>().dot(sVector.col(newest).template cast<Scalar>());
+            rho(newest) = 1.0 / ys;
+            k = std::min(k + 1, m);
 
-                sVector.leftCols(m - 1) = sVector.rightCols(m - 1).eval();
-                sVector.rightCols(1) = s;
-                yVector.leftCols(m - 1) = yVector.rightCols(m - 1).eval();
-                yVector.rightCols(1) = y;
-            }
             // update the scaling factor
-            H0k = y.dot(s) / static_cast<double>(y.dot(y));
+            H0k = ys / yVector.col(newest).template cast<Scalar>().squaredNorm();
 
             x_old = x0;
             // std::cout << "iter: "<<globIter<< ", f = " <<  objFunc.value(x0) << ", ||g||_inf "
             // <<gradNorm  << std::endl;
 
-            iter++;
-            globIter++;
             ++this->m_current.iterations;
             this->m_current.gradNorm = grad.template lpNorm<Eigen::Infinity>();
             this->m_status = checkConvergence(this->m_stop, this->m_current);
         } while ((objFunc.callback(this->m_current, x0)) && (this->m_status == Status::Continue));
-
+        this->recordEvaluations(objFunc);
     }
 
 };
@@ -45,10 +45,12 @@ class NelderMeadSolver : public ISolver<ProblemType, 0> {
     }
 
     // compute function values
+    typename ProblemType::TBatchValues values;
+    objFunc.valueBatch(x0, values);
     std::vector<Scalar> f; f.resize(DIM + 1);
     std::vector<int> index; index.resize(DIM + 1);
     for (int i = 0; i < DIM + 1; ++i) {
-      f[i] = objFunc(static_cast<TVector >(x0.col(i)));
+      f[i] = values[i];
       index[i] = i;
     }
 
@@ -141,16 +143,20 @@ class NelderMeadSolver : public ISolver<ProblemType, 0> {
       iter++;
     }
     x = x0.col(index[0]);
+    this->recordEvaluations(objFunc);
   }
 
   void shrink(MatrixType &x, std::vector<int> &index, std::vector<Scalar> &f, ProblemType &objFunc) {
 
     const Scalar sig = 0.5;   // 0 < sig < 1
     const int DIM = x.rows();
-    f[index[0]] = objFunc(x.col(index[0]));
     for (int i = 1; i < DIM + 1; ++i) {
       x.col(index[i]) = sig * x.col(index[i]) + (1. - sig) * x.col(index[0]);
-      f[index[i]] = objFunc(x.col(index[i]));
+    }
+    typename ProblemType::TBatchValues values;
+    objFunc.valueBatch(x, values);
+    for (int i = 0; i < DIM + 1; ++i) {
+      f[i] = values[i];
     }
 
   }
@@ -35,6 +35,7 @@ class NewtonDescentSolver : public ISolver<ProblemType, 2> {
             this->m_current.gradNorm = grad.template lpNorm<Eigen::Infinity>();
             this->m_status = checkConvergence(this->m_stop, this->m_current);
         } while (objFunc.callback(this->m_current, x0) && (this->m_status == Status::Continue));
+        this->recordEvaluations(objFunc);
     }
 };
 
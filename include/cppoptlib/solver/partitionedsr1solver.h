@@ -0,0 +1,122 @@
+// CppNumericalSolver
+#ifndef PARTITIONEDSR1SOLVER_H_
+#define PARTITIONEDSR1SOLVER_H_
+
+#include <cmath>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/SparseCholesky>
+#include "isolver.h"
+#include "../linesearch/morethuente.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief quasi-Newton method with one approximation per element (partitioned updates)
+ * @details for a PartiallySeparableProblem every element keeps a small dense approximation
+ *          of its own hessian, updated from the element's own gradient change. The sum of
+ *          the elements is a sparse matrix with the structure of the true hessian and is
+ *          factorised by a sparse LDLT decomposition. Elements are updated by the symmetric
+ *          rank one formula, which unlike BFGS can represent the indefinite hessian of a
+ *          nonconvex element. When the sum is not positive definite, a multiple of the
+ *          identity is added before solving for the search direction.
+ */
+template<typename ProblemType>
+class PartitionedSr1Solver : public ISolver<ProblemType, 1> {
+ public:
+  using Superclass = ISolver<ProblemType, 1>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using TIndex = typename ProblemType::TIndex;
+  using TElementVector = typename ProblemType::TElementVector;
+  using TMatrix = typename ProblemType::TMatrix;
+  using TSparseHessian = typename ProblemType::TSparseHessian;
+
+ protected:
+  /**
+   * @brief symmetric rank one update of one element approximation
+   * @details skipped when the denominator is small, the update would be unstable
+   */
+  static void update(TMatrix &B, const TElementVector &s, const TElementVector &y) {
+    using std::abs;
+    const TElementVector r = y - B * s;
+    const Scalar rs = r.dot(s);
+    if (abs(rs) > 1e-8 * r.norm() * s.norm())
+      B += r * r.transpose() / rs;
+  }
+
+  /**
+   * @brief factorises H + tau I with the smallest tau = 0, 1e-3 max|H_ii|, ... that is
+   *        positive definite
+   * @details H has to store its whole diagonal, so that the shift keeps the analysed pattern
+   */
+  static void factorize(Eigen::SimplicialLDLT<TSparseHessian> &solver, TSparseHessian &H) {
+    TSparseHessian I(H.rows(), H.cols());
+    I.setIdentity();
+    const Scalar scale = std::max(H.diagonal().cwiseAbs().maxCoeff(), Scalar(1.));
+    Scalar tau = 0;
+    for (int attempt = 0; attempt < 60; ++attempt) {
+      solver.factorize((tau > 0) ? TSparseHessian(H + tau * I) : H);
+      if ((solver.info() == Eigen::Success) && (solver.vectorD().minCoeff() > 0))
+        return;
+      tau = (tau > 0) ? 4 * tau : 1e-3 * scale;
+    }
+  }
+
+ public:
+  void minimize(ProblemType &objFunc, TVector &x0) {
+    const TIndex numElements = objFunc.numElements();
+    std::vector<TMatrix> B(numElements);
+    for (TIndex k = 0; k < numElements; ++k) {
+      const TIndex n = objFunc.elementVariables(k).size();
+      B[k] = TMatrix::Identity(n, n);
+    }
+
+    std::vector<TElementVector> grads, gradsOld;
+    TVector grad, searchDir;
+    TSparseHessian H;
+    Eigen::SimplicialLDLT<TSparseHessian> solver;
+    objFunc.elementGradients(x0, grads);
+    objFunc.assembleGradient(grads, grad);
+
+    this->m_current.reset();
+    do {
+      objFunc.assembleHessian(B, H);
+      if (this->m_current.iterations == 0)
+        solver.analyzePattern(H);
+      factorize(solver, H);
+      searchDir = solver.solve(-grad);
+      if ((solver.info() != Eigen::Success) || !(grad.dot(searchDir) < 0))
+        searchDir = -grad;
+
+      const Scalar rate = MoreThuente<ProblemType, 1>::linesearch(x0, searchDir, objFunc);
+      const TVector s = rate * searchDir;
+      x0 += s;
+
+      gradsOld.swap(grads);
+      // the line search ends with valueAndGradient() in x0
+      if (!objFunc.takeElementGradients(x0, grads))
+        objFunc.elementGradients(x0, grads);
+      objFunc.assembleGradient(grads, grad);
+
+      for (TIndex k = 0; k < numElements; ++k) {
+        const std::vector<TIndex> &variables = objFunc.elementVariables(k);
+        TElementVector sk(variables.size());
+        for (size_t i = 0; i < variables.size(); ++i)
+          sk[i] = s[variables[i]];
+        const TElementVector yk = grads[k] - gradsOld[k];
+        update(B[k], sk, yk);
+      }
+
+      ++this->m_current.iterations;
+      this->m_current.xDelta = s.template lpNorm<Eigen::Infinity>();
+      this->m_current.gradNorm = grad.template lpNorm<Eigen::Infinity>();
+      this->m_status = checkConvergence(this->m_stop, this->m_current);
+    } while (objFunc.callback(this->m_current, x0) && (this->m_status == Status::Continue));
+    this->recordEvaluations(objFunc);
+  }
+};
+
+} /* namespace cppoptlib */
+
+#endif /* PARTITIONEDSR1SOLVER_H_ */
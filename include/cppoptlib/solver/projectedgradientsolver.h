@@ -0,0 +1,71 @@
+// CppNumericalSolver
+#ifndef PROJECTEDGRADIENTSOLVER_H_
+#define PROJECTEDGRADIENTSOLVER_H_
+
+#include <cmath>
+#include <limits>
+#include <Eigen/Core>
+#include "isolver.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief spectral projected gradient method
+ * @details for problems providing project(x), e.g. LinearlyConstrainedProblem. Every
+ *          iteration steps along the negative gradient with the Barzilai-Borwein step
+ *          length, projects back onto the feasible set and backtracks until the Armijo
+ *          condition holds along the projected step. The gradient norm reported to the
+ *          stopping criteria is the norm of the projected gradient step P(x - g) - x,
+ *          which vanishes exactly at stationary points of the constrained problem.
+ */
+template<typename ProblemType>
+class ProjectedGradientSolver : public ISolver<ProblemType, 1> {
+ public:
+  using Superclass = ISolver<ProblemType, 1>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+
+  void minimize(ProblemType &objFunc, TVector &x0) {
+    using std::abs;
+    const Scalar minStep = std::numeric_limits<Scalar>::epsilon();
+    const Scalar maxStep = 1 / minStep;
+    objFunc.project(x0);
+    TVector grad(x0.rows()), gradNew(x0.rows()), x, stationarity;
+    Scalar f = objFunc.valueAndGradient(x0, grad);
+    Scalar step = 1 / std::max(grad.template lpNorm<Eigen::Infinity>(), Scalar(1.));
+    this->m_current.reset();
+    do {
+      Scalar rate = step;
+      Scalar fNew = f;
+      for (int backtrack = 0; backtrack < 60; ++backtrack) {
+        x = x0 - rate * grad;
+        objFunc.project(x);
+        fNew = objFunc.value(x);
+        if (fNew <= f + Scalar(1e-4) * grad.dot(x - x0))
+          break;
+        rate /= 2;
+      }
+      const TVector s = x - x0;
+      fNew = objFunc.valueAndGradient(x, gradNew);
+      const Scalar sy = s.dot(gradNew - grad);
+      step = (sy > 0) ? std::min(std::max(s.squaredNorm() / sy, minStep), maxStep) : maxStep;
+
+      this->m_current.fDelta = abs(f - fNew);
+      this->m_current.xDelta = s.template lpNorm<Eigen::Infinity>();
+      x0 = x;
+      grad = gradNew;
+      f = fNew;
+
+      stationarity = x0 - grad;
+      objFunc.project(stationarity);
+      ++this->m_current.iterations;
+      this->m_current.gradNorm = (stationarity - x0).template lpNorm<Eigen::Infinity>();
+      this->m_status = checkConvergence(this->m_stop, this->m_current);
+    } while (objFunc.callback(this->m_current, x0) && (this->m_status == Status::Continue));
+    this->recordEvaluations(objFunc);
+  }
+};
+
+} /* namespace cppoptlib */
+
+#endif /* PROJECTEDGRADIENTSOLVER_H_ */
@@ -0,0 +1,126 @@
+// CppNumericalSolver
+#include <algorithm>
+#include <Eigen/Core>
+#include "isolver.h"
+#include "../linesearch/morethuente.h"
+
+#ifndef VLBFGSSOLVER_H_
+#define VLBFGSSOLVER_H_
+
+namespace cppoptlib {
+
+/**
+ * @brief vector-free limited memory BFGS (Chen et al. 2014)
+ * @details the L-BFGS direction is a linear combination of the 2m + 1 vectors
+ *          s_0 .. s_{m-1}, y_0 .. y_{m-1}, g. Their (2m + 1)^2 matrix of dot products is
+ *          updated with the dot products of the three new vectors only, one matrix
+ *          product over the stored vectors per iteration. The two-loop recursion then
+ *          runs on the coefficients of the combination using the small matrix alone, and
+ *          the direction is formed by one more matrix-vector product. Each iteration thus
+ *          reads the history twice instead of 4m times. The dot products are the only
+ *          reductions, which makes this variant the base for distributed L-BFGS.
+ *          Directions equal those of LbfgsSolver up to rounding.
+ */
+template<typename ProblemType>
+class VlbfgsSolver : public ISolver<ProblemType, 1> {
+  public:
+    using Superclass = ISolver<ProblemType, 1>;
+    using typename Superclass::Scalar;
+    using typename Superclass::TVector;
+    using MatrixType = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+    using VectorType = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+  protected:
+    int m_historySize = 10;
+
+  public:
+    /**
+     * @brief number of correction pairs kept, 10 by default
+     */
+    void setHistorySize(int m) { m_historySize = std::max(m, 1); }
+    int historySize() const { return m_historySize; }
+
+    void minimize(ProblemType &objFunc, TVector &x0) {
+        const int m = m_historySize;
+        const int g = 2 * m;
+        const size_t DIM = x0.rows();
+        // columns 0 .. m-1 hold s, m .. 2m-1 hold y (both circular) and 2m the gradient
+        MatrixType basis = MatrixType::Zero(DIM, 2 * m + 1);
+        MatrixType gram = MatrixType::Zero(2 * m + 1, 2 * m + 1);
+        // newest s, y and gradient before they are stored and their dot products
+        MatrixType fresh(DIM, 3);
+        MatrixType dots(2 * m + 1, 3);
+        VectorType delta(2 * m + 1), alpha(m);
+        TVector grad(DIM), searchDir(DIM), x_old = x0;
+
+        objFunc.gradient(x0, grad);
+        basis.col(g) = grad;
+        gram(g, g) = grad.squaredNorm();
+
+        // number of stored pairs and column of the newest one
+        int k = 0, newest = m - 1;
+        this->m_current.reset();
+        do {
+            const Scalar relativeEpsilon = static_cast<Scalar>(0.0001) * std::max(static_cast<Scalar>(1.0), x0.norm());
+
+            if (grad.norm() < relativeEpsilon)
+                break;
+
+            // two-loop recursion on the coefficients of -H g
+            delta.setZero();
+            delta(g) = -1;
+            for (int j = 0, i = newest; j < k; ++j, i = (i + m - 1) % m) {
+                alpha(i) = gram.col(i).dot(delta) / gram(i, m + i);
+                delta(m + i) -= alpha(i);
+            }
+            if (k > 0)
+                delta *= gram(newest, m + newest) / gram(m + newest, m + newest);
+            for (int j = 0, i = (newest + m - k + 1) % m; j < k; ++j, i = (i + 1) % m) {
+                const Scalar beta = gram.col(m + i).dot(delta) / gram(i, m + i);
+                delta(i) += alpha(i) - beta;
+            }
+            searchDir.noalias() = basis * delta;
+
+            // any issues with the descent direction ?
+            Scalar alpha_init = 1.0 / grad.norm();
+            if (grad.dot(searchDir) > -0.0001 * relativeEpsilon) {
+                searchDir = -grad;
+                k = 0;
+                alpha_init = 1.0;
+            }
+
+            const Scalar rate = MoreThuente<ProblemType, 1>::linesearch(x0, searchDir, objFunc, alpha_init);
+            x0.noalias() += rate * searchDir;
+            objFunc.gradient(x0, grad);
+
+            fresh.col(0) = x0 - x_old;
+            fresh.col(1) = grad - basis.col(g);
+            fresh.col(2) = grad;
+            x_old = x0;
+
+            // the newest pair replaces the oldest one
+            newest = (newest + 1) % m;
+            k = std::min(k + 1, m);
+            basis.col(newest) = fresh.col(0);
+            basis.col(m + newest) = fresh.col(1);
+            basis.col(g) = fresh.col(2);
+            dots.noalias() = basis.transpose() * fresh;
+            const int updated[3] = {newest, m + newest, g};
+            for (int c = 0; c < 3; ++c) {
+                gram.col(updated[c]) = dots.col(c);
+                gram.row(updated[c]) = dots.col(c).transpose();
+            }
+
+            ++this->m_current.iterations;
+            this->m_current.gradNorm = grad.template lpNorm<Eigen::Infinity>();
+            this->m_status = checkConvergence(this->m_stop, this->m_current);
+        } while ((objFunc.callback(this->m_current, x0)) && (this->m_status == Status::Continue));
+        this->recordEvaluations(objFunc);
+    }
+
+};
+
+}
+/* namespace cppoptlib */
+
+#endif /* VLBFGSSOLVER_H_ */
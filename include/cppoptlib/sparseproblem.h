@@ -0,0 +1,287 @@
+// CppNumericalSolver
+#ifndef SPARSEPROBLEM_H
+#define SPARSEPROBLEM_H
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+#include "colouring.h"
+#include "problem.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief problem with a known sparsity structure
+ * @details two kinds of structure can be declared:
+ *          - the sparsity pattern of the hessian. Finite difference hessians then
+ *            perturb all structurally independent coordinates together and need one
+ *            gradient difference per colour instead of one per coordinate.
+ *          - the variables each element function depends on, for objectives that
+ *            are a sum of element functions f(x) = sum_k f_k(x). Together with
+ *            elementValues() this gives a finite difference gradient that needs one
+ *            evaluation of all elements per colour.
+ *          With more than one thread clone() must return a problem of the same type.
+ */
+template<typename Scalar_, int Dim_ = Eigen::Dynamic>
+class SparseProblem : public Problem<Scalar_, Dim_> {
+ public:
+  using Superclass = Problem<Scalar_, Dim_>;
+  using typename Superclass::Scalar;
+  using typename Superclass::TVector;
+  using typename Superclass::THessian;
+  using typename Superclass::TIndex;
+  using TSparseHessian = Eigen::SparseMatrix<Scalar>;
+  using TElementVector = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+  using TMatrix = Eigen::Matrix<Scalar, Eigen::Dynamic, Eigen::Dynamic>;
+
+ protected:
+  // rows of the nonzeros in each column of the hessian
+  std::vector<std::vector<TIndex>> m_hessianPattern;
+  std::vector<int> m_hessianColours;
+  int m_numHessianColours = 0;
+  // elements depending on each variable
+  std::vector<std::vector<TIndex>> m_elementPattern;
+  std::vector<int> m_elementColours;
+  int m_numElementColours = 0;
+  TIndex m_numElements = 0;
+
+  /**
+   * @brief groups the columns by colour
+   */
+  static std::vector<std::vector<TIndex>> colourGroups(const std::vector<int> &colours, int numColours) {
+    std::vector<std::vector<TIndex>> groups(numColours);
+    for (size_t j = 0; j < colours.size(); ++j)
+      groups[colours[j]].push_back(j);
+    return groups;
+  }
+
+ public:
+  SparseProblem() : Superclass() {}
+
+  /**
+   * @brief declares which entries of the hessian can be nonzero
+   * @details only the structure of pattern is used, it is symmetrised and the
+   *          diagonal is always included
+   */
+  void setHessianSparsity(const TSparseHessian &pattern) {
+    const TIndex D = pattern.cols();
+    m_hessianPattern.assign(D, std::vector<TIndex>());
+    for (TIndex j = 0; j < D; ++j)
+      m_hessianPattern[j].push_back(j);
+    for (TIndex k = 0; k < pattern.outerSize(); ++k) {
+      for (typename TSparseHessian::InnerIterator it(pattern, k); it; ++it) {
+        m_hessianPattern[it.col()].push_back(it.row());
+        m_hessianPattern[it.row()].push_back(it.col());
+      }
+    }
+    for (auto &rows : m_hessianPattern) {
+      std::sort(rows.begin(), rows.end());
+      rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+    }
+    m_numHessianColours = colourColumns(m_hessianPattern, D, m_hessianColours);
+  }
+
+  bool hasHessianSparsity() const { return !m_hessianPattern.empty(); }
+  int numHessianColours() const { return m_numHessianColours; }
+
+  /**
+   * @brief declares the element functions of a partially separable objective
+   *
+   * @param D number of variables
+   * @param variables indices of the variables element k depends on
+   */
+  void setElementVariables(TIndex D, const std::vector<std::vector<TIndex>> &variables) {
+    m_numElements = variables.size();
+    m_elementPattern.assign(D, std::vector<TIndex>());
+    for (TIndex k = 0; k < m_numElements; ++k) {
+      for (TIndex j : variables[k]) {
+        assert((j >= 0) && (j < D));
+        m_elementPattern[j].push_back(k);
+      }
+    }
+    m_numElementColours = colourColumns(m_elementPattern, m_numElements, m_elementColours);
+  }
+
+  TIndex numElements() const { return m_numElements; }
+  int numElementColours() const { return m_numElementColours; }
+
+  /**
+   * @brief returns the value of every element function in x
+   * @details must be overwritten if element variables have been declared, the sum of
+   *          all elements has to equal value(x)
+   */
+  virtual void elementValues(const TVector & /* x */, TElementVector & /* values */) {
+    throw std::logic_error("elementValues() must be overridden to use element variables");
+  }
+
+  /**
+   * @brief uses the element structure for finite differences if it has been declared
+   */
+  void gradient(const TVector &x, TVector &grad) {
+    if (m_numElements > 0) {
+      finiteSparseGradient(x, grad);
+    } else {
+      Superclass::gradient(x, grad);
+    }
+  }
+
+  /**
+   * @brief uses the hessian sparsity for finite differences if it has been declared
+   */
+  void hessian(const TVector &x, THessian &hessian) {
+    if (hasHessianSparsity()) {
+      TSparseHessian sparse;
+      sparseHessian(x, sparse);
+      hessian = sparse.toDense();
+    } else {
+      Superclass::hessian(x, hessian);
+    }
+  }
+
+  /**
+   * @brief returns the hessian in x as sparse matrix
+   * @details should be overwritten by a symbolic hessian. Otherwise it is computed from
+   *          gradient differences, forward if hasAnalyticGradient() and central with a
+   *          larger step if the gradient is a finite difference approximation itself.
+   */
+  virtual void sparseHessian(const TVector &x, TSparseHessian &hessian) {
+    using std::sqrt;
+    if (hasHessianSparsity()) {
+      if (this->hasAnalyticGradient())
+        finiteSparseHessian(x, hessian, 0);
+      else
+        finiteSparseHessian(x, hessian, 1, sqrt(sqrt(std::numeric_limits<Scalar>::epsilon())));
+    } else {
+      THessian dense;
+      Superclass::hessian(x, dense);
+      hessian = dense.sparseView();
+    }
+  }
+
+  /**
+   * @brief finite difference gradient of a partially separable objective
+   * @details variables of one colour never share an element, so each element
+   *          difference belongs to exactly one perturbed variable. Needs 1 + colours
+   *          (accuracy 0) or 2 * colours (otherwise) calls of elementValues().
+   */
+  void finiteSparseGradient(const TVector &x, TVector &grad, int accuracy = 0) {
+    using std::abs;
+    using std::cbrt;
+    using std::sqrt;
+    const TIndex D = x.rows();
+    const Scalar eps = (accuracy == 0) ? sqrt(std::numeric_limits<Scalar>::epsilon())
+                                       : cbrt(std::numeric_limits<Scalar>::epsilon());
+    TVector steps(D);
+    for (TIndex j = 0; j < D; ++j)
+      steps[j] = eps * std::max(abs(x[j]), Scalar(1.));
+
+    TElementVector values0;
+    if (accuracy == 0)
+      elementValues(x, values0);
+
+    const std::vector<std::vector<TIndex>> groups = colourGroups(m_elementColours, m_numElementColours);
+    TMatrix diffs(m_numElements, m_numElementColours);
+
+    const int threads = std::min(this->m_threads, std::max(m_numElementColours, 1));
+    std::vector<std::unique_ptr<Superclass>> owned;
+    const std::vector<Superclass *> problems = this->threadProblems(threads, owned);
+    std::vector<TVector, Eigen::aligned_allocator<TVector>> xx(threads, x);
+    std::vector<TElementVector> valuesPlus(threads), valuesMinus(threads);
+
+    parallelFor(0, m_numElementColours, threads, [&](int t, TIndex c) {
+      SparseProblem *problem = static_cast<SparseProblem *>(problems[t]);
+      for (TIndex j : groups[c])
+        xx[t][j] += steps[j];
+      problem->elementValues(xx[t], valuesPlus[t]);
+      if (accuracy == 0) {
+        diffs.col(c) = valuesPlus[t] - values0;
+      } else {
+        for (TIndex j : groups[c])
+          xx[t][j] = x[j] - steps[j];
+        problem->elementValues(xx[t], valuesMinus[t]);
+        diffs.col(c) = 0.5 * (valuesPlus[t] - valuesMinus[t]);
+      }
+      for (TIndex j : groups[c])
+        xx[t][j] = x[j];
+    });
+
+    grad.resize(D);
+    for (TIndex j = 0; j < D; ++j) {
+      Scalar sum = 0;
+      for (TIndex k : m_elementPattern[j])
+        sum += diffs(k, m_elementColours[j]);
+      grad[j] = sum / steps[j];
+    }
+  }
+
+  /**
+   * @brief sparse finite difference hessian from gradient differences
+   * @details coordinates of one colour share no row of the hessian, so all of them are
+   *          perturbed together. Needs 1 + colours (accuracy 0) or 2 * colours
+   *          (otherwise) gradient calls, the result is symmetrised.
+   *
+   * @param step relative step size, by default the square (accuracy 0) or cubic
+   *             root of the machine epsilon
+   */
+  void finiteSparseHessian(const TVector &x, TSparseHessian &hessian, int accuracy = 0, Scalar step = 0) {
+    using std::abs;
+    using std::cbrt;
+    using std::sqrt;
+    const TIndex D = x.rows();
+    const Scalar eps = (step > 0) ? step :
+                       (accuracy == 0) ? sqrt(std::numeric_limits<Scalar>::epsilon())
+                                       : cbrt(std::numeric_limits<Scalar>::epsilon());
+    TVector steps(D);
+    for (TIndex j = 0; j < D; ++j)
+      steps[j] = eps * std::max(abs(x[j]), Scalar(1.));
+
+    TVector grad0;
+    if (accuracy == 0) {
+      grad0.resize(D);
+      this->gradient(x, grad0);
+    }
+
+    const std::vector<std::vector<TIndex>> groups = colourGroups(m_hessianColours, m_numHessianColours);
+    TMatrix diffs(D, m_numHessianColours);
+
+    const int threads = std::min(this->m_threads, std::max(m_numHessianColours, 1));
+    std::vector<std::unique_ptr<Superclass>> owned;
+    const std::vector<Superclass *> problems = this->threadProblems(threads, owned);
+    std::vector<TVector, Eigen::aligned_allocator<TVector>> xx(threads, x);
+    std::vector<TVector, Eigen::aligned_allocator<TVector>> gradPlus(threads, TVector(D));
+    std::vector<TVector, Eigen::aligned_allocator<TVector>> gradMinus(threads, TVector(D));
+
+    parallelFor(0, m_numHessianColours, threads, [&](int t, TIndex c) {
+      for (TIndex j : groups[c])
+        xx[t][j] += steps[j];
+      problems[t]->gradient(xx[t], gradPlus[t]);
+      if (accuracy == 0) {
+        diffs.col(c) = gradPlus[t] - grad0;
+      } else {
+        for (TIndex j : groups[c])
+          xx[t][j] = x[j] - steps[j];
+        problems[t]->gradient(xx[t], gradMinus[t]);
+        diffs.col(c) = 0.5 * (gradPlus[t] - gradMinus[t]);
+      }
+      for (TIndex j : groups[c])
+        xx[t][j] = x[j];
+    });
+
+    std::vector<Eigen::Triplet<Scalar>> entries;
+    for (TIndex j = 0; j < D; ++j) {
+      for (TIndex i : m_hessianPattern[j])
+        entries.push_back(Eigen::Triplet<Scalar>(i, j, diffs(i, m_hessianColours[j]) / steps[j]));
+    }
+    TSparseHessian oneSided(D, D);
+    oneSided.setFromTriplets(entries.begin(), entries.end());
+    hessian = 0.5 * (oneSided + TSparseHessian(oneSided.transpose()));
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // SPARSEPROBLEM_H
@@ -0,0 +1,134 @@
+// CppNumericalSolver
+#ifndef STATICPROBLEM_H
+#define STATICPROBLEM_H
+
+#include <type_traits>
+#include <Eigen/Core>
+
+#include "finitedifferences.h"
+#include "meta.h"
+
+namespace cppoptlib {
+
+/**
+ * @brief problem interface without virtual functions (curiously recurring template)
+ * @details an alternative to Problem for small objectives evaluated very often. Derive as
+ *          class MyProblem : public StaticProblem<MyProblem, double, 2> and define value()
+ *          and optionally gradient() and hessian() without virtual. Solvers are templated
+ *          on the problem type, so every call resolves at compile time and can be inlined.
+ *          Whether gradient() or hessian() have been defined is known at compile time
+ *          (hasGradient(), hasHessian()) and selects the finite differences that are used
+ *          for the missing derivatives. All evaluations are serial.
+ *
+ * @tparam Derived the problem deriving from this class
+ */
+template<typename Derived, typename Scalar_, int Dim_ = Eigen::Dynamic>
+class StaticProblem {
+ public:
+  static const int Dim = Dim_;
+  typedef Scalar_ Scalar;
+  using TVector   = Eigen::Matrix<Scalar, Dim, 1>;
+  using THessian  = Eigen::Matrix<Scalar, Dim, Dim>;
+  using TCriteria = Criteria<Scalar>;
+  using TIndex = typename TVector::Index;
+  using TBatch = Eigen::Matrix<Scalar, Dim, Eigen::Dynamic>;
+  using TBatchValues = Eigen::Matrix<Scalar, Eigen::Dynamic, 1>;
+
+ protected:
+  Derived &derived() { return static_cast<Derived &>(*this); }
+
+  void defaultHessian(const TVector &x, THessian &hessian, std::true_type /* gradient */) {
+    finiteDifferenceHessianFromGradient(x, hessian, 0, 1,
+                                        [this](int, const TVector &xx, TVector &g) { derived().gradient(xx, g); });
+  }
+
+  void defaultHessian(const TVector &x, THessian &hessian, std::false_type /* gradient */) {
+    finiteHessian(x, hessian);
+  }
+
+ public:
+  /**
+   * @brief true if Derived defines its own gradient()
+   */
+  static constexpr bool hasGradient() {
+    return !std::is_same<decltype(&Derived::gradient), decltype(&StaticProblem::gradient)>::value;
+  }
+
+  /**
+   * @brief true if Derived defines its own hessian()
+   */
+  static constexpr bool hasHessian() {
+    return !std::is_same<decltype(&Derived::hessian), decltype(&StaticProblem::hessian)>::value;
+  }
+
+  bool callback(const TCriteria &/* state */, const TVector &/* x */) {
+    return true;
+  }
+
+  Scalar operator()(const TVector &x) {
+    return derived().value(x);
+  }
+
+  /**
+   * @brief finite difference gradient unless Derived defines its own
+   */
+  void gradient(const TVector &x, TVector &grad) {
+    finiteGradient(x, grad);
+  }
+
+  Scalar valueAndGradient(const TVector &x, TVector &grad) {
+    derived().gradient(x, grad);
+    return derived().value(x);
+  }
+
+  /**
+   * @brief forward differences of the gradient if Derived defines one, second
+   *        differences of the objective value otherwise
+   */
+  void hessian(const TVector &x, THessian &hessian) {
+    defaultHessian(x, hessian, std::integral_constant<bool, hasGradient()>());
+  }
+
+  /**
+   * @brief forward difference of the gradient along v if Derived defines a gradient,
+   *        central difference with a larger step otherwise
+   */
+  void hessianVectorProduct(const TVector &x, const TVector &v, TVector &Hv) {
+    auto gradient = [this](const TVector &xx, TVector &g) { derived().gradient(xx, g); };
+    if (hasGradient()) {
+      TVector grad0(x.rows());
+      derived().gradient(x, grad0);
+      forwardDifferenceHessianVectorProduct(x, grad0, v, Hv, gradient);
+    } else {
+      centralDifferenceHessianVectorProduct(x, v, Hv, gradient);
+    }
+  }
+
+  void valueBatch(const TBatch &X, TBatchValues &f) {
+    f.resize(X.cols());
+    TVector x;
+    for (TIndex i = 0; i < X.cols(); ++i) {
+      x = X.col(i);
+      f[i] = derived().value(x);
+    }
+  }
+
+  /**
+   * @brief central differences, the same as Problem::finiteGradient
+   */
+  void finiteGradient(const TVector &x, TVector &grad, int accuracy = 0) {
+    finiteDifferenceGradient(x, grad, accuracy, 1,
+                             [this](const TBatch &X, TBatchValues &f) { derived().valueBatch(X, f); });
+  }
+
+  /**
+   * @brief differences of the objective value, the same as Problem::finiteHessian
+   */
+  void finiteHessian(const TVector &x, THessian &hessian, int accuracy = 0) {
+    finiteDifferenceHessian(x, hessian, accuracy, 1, [this](int, const TVector &xx) { return derived().value(xx); });
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // STATICPROBLEM_H
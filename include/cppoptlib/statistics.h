@@ -0,0 +1,129 @@
+// CppNumericalSolver
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+namespace cppoptlib {
+
+/**
+ * @brief number and latency of the calls of one kind
+ * @details histogram[b] counts the calls that took [2^b, 2^(b+1)) nanoseconds,
+ *          the first bucket also holds calls below one nanosecond and the last one
+ *          everything longer.
+ */
+struct CallStatistics {
+  static const int Buckets = 40;
+
+  uint64_t calls = 0;
+  uint64_t nanoseconds = 0;
+  std::array<uint64_t, Buckets> histogram = {};
+
+  double seconds() const { return 1e-9 * nanoseconds; }
+  double meanSeconds() const { return (calls > 0) ? seconds() / calls : 0.; }
+
+  /**
+   * @brief upper bound of the q-quantile of the latency in seconds
+   * @details the histogram only knows powers of two, so this is exact up to a factor 2
+   */
+  double quantileSeconds(double q) const {
+    const double rank = q * calls;
+    uint64_t count = 0;
+    for (int b = 0; b < Buckets; ++b) {
+      count += histogram[b];
+      if ((count > 0) && (count >= rank))
+        return 1e-9 * static_cast<double>(uint64_t(1) << (b + 1));
+    }
+    return 0.;
+  }
+
+  void print(std::ostream &os) const {
+    os << calls << " calls, " << seconds() << " s, mean " << meanSeconds()
+       << " s, median < " << quantileSeconds(0.5) << " s, 99% < " << quantileSeconds(0.99) << " s";
+  }
+};
+
+/**
+ * @brief calls a solver made to its problem, see InstrumentedProblem
+ */
+struct EvaluationStatistics {
+  CallStatistics value;
+  CallStatistics gradient;
+  CallStatistics valueAndGradient;
+  CallStatistics hessian;
+  CallStatistics hessianVectorProduct;
+  CallStatistics valueBatch;
+
+  /**
+   * @brief time spent in the objective, the rest of minimize() is solver overhead
+   */
+  double seconds() const {
+    return value.seconds() + gradient.seconds() + valueAndGradient.seconds() + hessian.seconds() +
+           hessianVectorProduct.seconds() + valueBatch.seconds();
+  }
+
+  void print(std::ostream &os) const {
+    os << "value:                "; value.print(os); os << std::endl;
+    os << "gradient:             "; gradient.print(os); os << std::endl;
+    os << "valueAndGradient:     "; valueAndGradient.print(os); os << std::endl;
+    os << "hessian:              "; hessian.print(os); os << std::endl;
+    os << "hessianVectorProduct: "; hessianVectorProduct.print(os); os << std::endl;
+    os << "valueBatch:           "; valueBatch.print(os); os << std::endl;
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &os, const EvaluationStatistics &s) {
+  s.print(os);
+  return os;
+}
+
+/**
+ * @brief thread-safe collector of CallStatistics
+ * @details all counters are relaxed atomics, so concurrent calls (e.g. from parallel
+ *          finite differences) can record without locking
+ */
+class CallRecorder {
+  std::atomic<uint64_t> m_calls;
+  std::atomic<uint64_t> m_nanoseconds;
+  std::array<std::atomic<uint64_t>, CallStatistics::Buckets> m_histogram;
+
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  CallRecorder() { reset(); }
+
+  void reset() {
+    m_calls.store(0, std::memory_order_relaxed);
+    m_nanoseconds.store(0, std::memory_order_relaxed);
+    for (auto &h : m_histogram)
+      h.store(0, std::memory_order_relaxed);
+  }
+
+  void record(Clock::time_point start) {
+    const int64_t elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    const uint64_t ns = (elapsed > 0) ? static_cast<uint64_t>(elapsed) : 0;
+    int b = 0;
+    for (uint64_t n = ns >> 1; (n > 0) && (b < CallStatistics::Buckets - 1); n >>= 1)
+      ++b;
+    m_calls.fetch_add(1, std::memory_order_relaxed);
+    m_nanoseconds.fetch_add(ns, std::memory_order_relaxed);
+    m_histogram[b].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  CallStatistics snapshot() const {
+    CallStatistics s;
+    s.calls = m_calls.load(std::memory_order_relaxed);
+    s.nanoseconds = m_nanoseconds.load(std::memory_order_relaxed);
+    for (int b = 0; b < CallStatistics::Buckets; ++b)
+      s.histogram[b] = m_histogram[b].load(std::memory_order_relaxed);
+    return s;
+  }
+};
+
+} // end namespace cppoptlib
+
+#endif // STATISTICS_H
@@ -27,24 +27,45 @@ size_t in_cols;
 
 char error_msg[200];
 
+// Every evaluation copies x into an mxArray: mexCallMATLAB only takes arrays whose
+// data MATLAB allocated itself, so the solver's vectors cannot be passed directly.
+// The argument array is allocated once and reused, the answers are freed after use.
 template<typename T>
 class MATLABobjective : public Problem<T> {
+  mxArray *m_argument = nullptr;
+
+  mxArray *argument(const Vector<T> &x) {
+    if (!m_argument || mxGetM(m_argument) != size_t(x.rows()) || mxGetN(m_argument) != size_t(x.cols())) {
+      if (m_argument)
+        mxDestroyArray(m_argument);
+      m_argument = mxCreateDoubleMatrix(x.rows(), x.cols(), mxREAL);
+    }
+    memcpy(mxGetPr(m_argument), x.data(), x.size() * sizeof(T));
+    return m_argument;
+  }
+
  public:
+  MATLABobjective() {}
+  MATLABobjective(const MATLABobjective &) = delete;
+  MATLABobjective &operator=(const MATLABobjective &) = delete;
+  ~MATLABobjective() {
+    if (m_argument)
+      mxDestroyArray(m_argument);
+  }
+
   T value(const Vector<T> &x) {
     mxArray * objective_ans, *objective_param[1];
-    objective_param[0] = mxCreateDoubleMatrix(x.rows(), x.cols(), mxREAL);
-    const T *constVariablePtr = &x(0);
-    memcpy(mxGetPr(objective_param[0]), constVariablePtr, mxGetM(objective_param[0]) * mxGetN(objective_param[0]) * sizeof(*constVariablePtr));
+    objective_param[0] = argument(x);
     mexCallMATLAB(1, &objective_ans, 1, objective_param, nameObjectiveFunction) ;
-    return mxGetScalar(objective_ans);
+    const T fx = mxGetScalar(objective_ans);
+    mxDestroyArray(objective_ans);
+    return fx;
   }
 
   void gradient(const Vector<T> &x, Vector<T> &grad) {
     if (hasGradient) {
       mxArray * objective_ans, *objective_param[1];
-      objective_param[0] = mxCreateDoubleMatrix(x.rows(), x.cols(), mxREAL);
-      const double *constVariablePtr = &x(0);
-      memcpy(mxGetPr(objective_param[0]), constVariablePtr, mxGetM(objective_param[0]) * mxGetN(objective_param[0]) * sizeof(*constVariablePtr));
+      objective_param[0] = argument(x);
       mexCallMATLAB(1, &objective_ans, 1, objective_param, nameGradientFunction) ;
       size_t r = mxGetM(objective_ans);
       size_t c = mxGetN(objective_ans);
@@ -54,6 +75,7 @@ class MATLABobjective : public Problem<T> {
       }
 
       grad = Eigen::Map<Eigen::VectorXd>(mxGetPr(objective_ans), mxGetM(objective_ans) );
+      mxDestroyArray(objective_ans);
 
     } else {
       this->finiteGradient(x, grad);
@@ -64,9 +86,7 @@ class MATLABobjective : public Problem<T> {
     if (hasHessian) {
 
       mxArray * objective_ans, *objective_param[1];
-      objective_param[0] = mxCreateDoubleMatrix(x.rows(), x.cols(), mxREAL);
-      const double *constVariablePtr = &x(0);
-      memcpy(mxGetPr(objective_param[0]), constVariablePtr, mxGetM(objective_param[0]) * mxGetN(objective_param[0]) * sizeof(*constVariablePtr));
+      objective_param[0] = argument(x);
       mexCallMATLAB(1, &objective_ans, 1, objective_param, nameHessianFunction) ;
       size_t r = mxGetM(objective_ans);
       size_t c = mxGetN(objective_ans);
@@ -76,6 +96,7 @@ class MATLABobjective : public Problem<T> {
       }
 
       hessian = Eigen::Map<Eigen::MatrixXd>(mxGetPr(objective_ans), mxGetM(objective_ans) , mxGetN(objective_ans));
+      mxDestroyArray(objective_ans);
 
     } else {
       this->finiteHessian(x, hessian);
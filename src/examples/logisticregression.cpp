@@ -1,6 +1,7 @@
+#include <cmath>
 #include <iostream>
 #include "../../include/cppoptlib/meta.h"
-#include "../../include/cppoptlib/problem.h"
+#include "../../include/cppoptlib/finitesumproblem.h"
 #include "../../include/cppoptlib/solver/bfgssolver.h"
 
 // to use this library just use the namespace "cppoptlib"
@@ -8,24 +9,48 @@ namespace cppoptlib {
 
 // we define a new problem for optimizing the rosenbrock function
 // we use a templated-class rather than "auto"-lambda function for a clean architecture
+// every row of X is one term of the loss, so large data sets are processed in blocks
+// and stochastic solvers can work on minibatches of rows
 template<typename T>
-class LogisticRegression : public Problem<T> {
+class LogisticRegression : public FiniteSumProblem<T> {
   public:
-    using typename Problem<T>::TVector;
+    using typename FiniteSumProblem<T>::TVector;
+    using typename FiniteSumProblem<T>::TIndex;
+    using typename FiniteSumProblem<T>::TIndices;
     using MatrixType = Eigen::Matrix<T, Eigen::Dynamic, Eigen::Dynamic>;
     const MatrixType X;
     const TVector y;
-    const MatrixType XX;
 
-    LogisticRegression(const MatrixType &X_, const TVector y_) : X(X_), y(y_), XX(X_.transpose()*X_) {}
+    LogisticRegression(const MatrixType &X_, const TVector y_) : X(X_), y(y_) {}
 
-    T value(const TVector &beta) {
-        return (1.0/(1.0 + exp(-(X*beta).array())) - y.array()).matrix().squaredNorm();
+    TIndex numTerms() const { return X.rows(); }
+
+    // rows are visited one by one, so concurrent minibatches need no shared buffer
+    T minibatchValue(const TVector &beta, const TIndices &rows) {
+        T sum = 0;
+        for (TIndex i : rows) {
+            const T r = 1.0/(1.0 + std::exp(-X.row(i).dot(beta))) - y[i];
+            sum += r * r;
+        }
+        return sum / rows.size();
+    }
+
+    void minibatchGradient(const TVector &beta, const TIndices &rows, TVector &grad) {
+        minibatchValueAndGradient(beta, rows, grad);
     }
 
-    void gradient(const TVector &beta, TVector &grad) {
-        const TVector p = 1.0/(1.0 + exp(-(X*beta).array()));
-        grad = X.transpose()*(p-y);
+    // value and gradient share the product X*beta, so compute it only once
+    T minibatchValueAndGradient(const TVector &beta, const TIndices &rows, TVector &grad) {
+        T sum = 0;
+        grad = TVector::Zero(beta.rows());
+        for (TIndex i : rows) {
+            const T p = 1.0/(1.0 + std::exp(-X.row(i).dot(beta)));
+            const T r = p - y[i];
+            sum += r * r;
+            grad += (2 * r * p * (1 - p)) * X.row(i).transpose();
+        }
+        grad /= rows.size();
+        return sum / rows.size();
     }
 };
 
@@ -38,7 +38,7 @@ class Rosenbrock : public Problem<T, 2> {
     // if you want ot use 2nd-order solvers, I encourage you to specify the hessian
     // finite differences usually (this implementation) behave bad
     void hessian(const TVector &x, THessian &hessian) {
-        hessian(0, 0) = 1200 * x[0] * x[0] - 400 * x[1] + 1;
+        hessian(0, 0) = 1200 * x[0] * x[0] - 400 * x[1] + 2;
         hessian(0, 1) = -400 * x[0];
         hessian(1, 0) = -400 * x[0];
         hessian(1, 1) = 200;
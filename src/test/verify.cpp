@@ -6,14 +6,30 @@
 #include "../../gtest/googletest/include/gtest/gtest.h"
 #include "../../include/cppoptlib/meta.h"
 #include "../../include/cppoptlib/boundedproblem.h"
+#include "../../include/cppoptlib/cachedproblem.h"
+#include "../../include/cppoptlib/constrainedproblem.h"
+#include "../../include/cppoptlib/linearlyconstrainedproblem.h"
+#include "../../include/cppoptlib/instrumentedproblem.h"
+#include "../../include/cppoptlib/sparseproblem.h"
+#include "../../include/cppoptlib/partiallyseparableproblem.h"
+#include "../../include/cppoptlib/finitesumproblem.h"
+#include "../../include/cppoptlib/leastsquaresproblem.h"
+#include "../../include/cppoptlib/staticproblem.h"
+#include "../../include/cppoptlib/autodiff/forwarddiffproblem.h"
+#include "../../include/cppoptlib/autodiff/reversediffproblem.h"
+#include "../../include/cppoptlib/autodiff/complexstepproblem.h"
+#include "../../include/cppoptlib/autodiff/forwarddiffleastsquaresproblem.h"
 #include "../../include/cppoptlib/solver/gradientdescentsolver.h"
 #include "../../include/cppoptlib/solver/conjugatedgradientdescentsolver.h"
 #include "../../include/cppoptlib/solver/newtondescentsolver.h"
 #include "../../include/cppoptlib/solver/bfgssolver.h"
 #include "../../include/cppoptlib/solver/lbfgssolver.h"
+#include "../../include/cppoptlib/solver/vlbfgssolver.h"
 #include "../../include/cppoptlib/solver/lbfgsbsolver.h"
 #include "../../include/cppoptlib/solver/cmaessolver.h"
 #include "../../include/cppoptlib/solver/neldermeadsolver.h"
+#include "../../include/cppoptlib/solver/partitionedsr1solver.h"
+#include "../../include/cppoptlib/solver/projectedgradientsolver.h"
 #define PRECISION 1e-4
 using namespace cppoptlib;
 
@@ -35,6 +51,110 @@ class RosenbrockValue : public BoundedProblem<Scalar, 2> {
 
 };
 
+// chained rosenbrock, a sum of D-1 elements with tridiagonal hessian
+template<typename Scalar>
+class ChainedRosenbrock : public SparseProblem<Scalar> {
+  public:
+    using typename SparseProblem<Scalar>::TVector;
+    using typename SparseProblem<Scalar>::THessian;
+    using typename SparseProblem<Scalar>::TElementVector;
+    int elementEvaluations = 0;
+
+    void elementValues(const TVector &x, TElementVector &values) {
+        ++elementEvaluations;
+        values.resize(x.rows() - 1);
+        for (int i = 0; i < x.rows() - 1; ++i) {
+            const Scalar t1 = (1 - x[i]);
+            const Scalar t2 = (x[i + 1] - x[i] * x[i]);
+            values[i] = t1 * t1 + 100 * t2 * t2;
+        }
+    }
+
+    Scalar value(const TVector &x) {
+        TElementVector values;
+        elementValues(x, values);
+        return values.sum();
+    }
+
+    void analyticGradient(const TVector &x, TVector &grad) {
+        grad = TVector::Zero(x.rows());
+        for (int i = 0; i < x.rows() - 1; ++i) {
+            grad[i] += -2 * (1 - x[i]) - 400 * (x[i + 1] - x[i] * x[i]) * x[i];
+            grad[i + 1] += 200 * (x[i + 1] - x[i] * x[i]);
+        }
+    }
+
+    void analyticHessian(const TVector &x, THessian &hessian) {
+        hessian = THessian::Zero(x.rows(), x.rows());
+        for (int i = 0; i < x.rows() - 1; ++i) {
+            hessian(i, i) += 1200 * x[i] * x[i] - 400 * x[i + 1] + 2;
+            hessian(i, i + 1) += -400 * x[i];
+            hessian(i + 1, i) += -400 * x[i];
+            hessian(i + 1, i + 1) += 200;
+        }
+    }
+};
+
+// chained rosenbrock declared element by element
+class ChainedRosenbrockElements : public PartiallySeparableProblem<double> {
+  public:
+    explicit ChainedRosenbrockElements(int D) {
+        std::vector<std::vector<Eigen::DenseIndex>> elements;
+        for (int i = 0; i < D - 1; ++i)
+            elements.push_back({i, i + 1});
+        setElements(D, elements);
+    }
+
+    double elementValue(Eigen::DenseIndex, const TElementVector &xk) {
+        const double t1 = (1 - xk[0]);
+        const double t2 = (xk[1] - xk[0] * xk[0]);
+        return t1 * t1 + 100 * t2 * t2;
+    }
+};
+
+// fit of y = a exp(b t) to samples, templated for automatic differentiation
+template<typename Scalar>
+class ExponentialFit : public LeastSquaresProblem<Scalar> {
+  public:
+    using typename LeastSquaresProblem<Scalar>::TVector;
+    using typename LeastSquaresProblem<Scalar>::TResiduals;
+    const Eigen::VectorXd t, y;
+    ExponentialFit(const Eigen::VectorXd &t_, const Eigen::VectorXd &y_) : t(t_), y(y_) {}
+    void residuals(const TVector &x, TResiduals &r) {
+        using std::exp;
+        r.resize(t.rows());
+        for (int i = 0; i < t.rows(); ++i)
+            r[i] = x[0] * exp(x[1] * t[i]) - y[i];
+    }
+};
+
+// rosenbrock on the interface without virtual functions
+template<typename Scalar>
+class StaticRosenbrockValue : public StaticProblem<StaticRosenbrockValue<Scalar>, Scalar, 2> {
+  public:
+    using typename StaticProblem<StaticRosenbrockValue<Scalar>, Scalar, 2>::TVector;
+    Scalar value(const TVector &x) {
+        const Scalar t1 = (1 - x[0]);
+        const Scalar t2 = (x[1] - x[0] * x[0]);
+        return   t1 * t1 + 100 * t2 * t2;
+    }
+};
+
+template<typename Scalar>
+class StaticRosenbrockGradient : public StaticProblem<StaticRosenbrockGradient<Scalar>, Scalar, 2> {
+  public:
+    using typename StaticProblem<StaticRosenbrockGradient<Scalar>, Scalar, 2>::TVector;
+    Scalar value(const TVector &x) {
+        const Scalar t1 = (1 - x[0]);
+        const Scalar t2 = (x[1] - x[0] * x[0]);
+        return   t1 * t1 + 100 * t2 * t2;
+    }
+    void gradient(const TVector &x, TVector &grad) {
+        grad[0]  = -2 * (1 - x[0]) + 200 * (x[1] - x[0] * x[0]) * (-2 * x[0]);
+        grad[1]  = 200 * (x[1] - x[0] * x[0]);
+    }
+};
+
 // now we add the information about the gradient
 template<typename Scalar>
 class RosenbrockGradient : public RosenbrockValue<Scalar> {
@@ -52,6 +172,8 @@ class RosenbrockGradient : public RosenbrockValue<Scalar> {
         grad[1]  = 200 * (x[1] - x[0] * x[0]);
     }
 
+    bool hasAnalyticGradient() const { return true; }
+
 };
 
 // now we add the information about the hessian
@@ -72,7 +194,7 @@ class RosenbrockFull : public RosenbrockGradient<Scalar> {
     }*/
 
     void hessian(const TVector &x, THessian &hessian) {
-        hessian(0, 0) = 1200 * x[0] * x[0] - 400 * x[1] + 1;
+        hessian(0, 0) = 1200 * x[0] * x[0] - 400 * x[1] + 2;
         hessian(0, 1) = -400 * x[0];
         hessian(1, 0) = -400 * x[0];
         hessian(1, 1) = 200;
@@ -88,6 +210,8 @@ template <class T> class LbfgsbTest : public testing::Test{};
 template <class T> class CMAesTest : public testing::Test{};
 template <class T> class NelderMeadTest : public testing::Test{};
 template <class T> class CentralDifference : public testing::Test{};
+template <class T> class ProblemInterface : public testing::Test{};
+template <class T> class AutoDiff : public testing::Test{};
 
 #define SOLVE_PROBLEM( sol, func, a, b, fx ) \
     typedef func<TypeParam> TProblem;\
@@ -120,6 +244,8 @@ TYPED_TEST_CASE(LbfgsbTest, MyTypeList);
 TYPED_TEST_CASE(CMAesTest, MyTypeList);
 TYPED_TEST_CASE(NelderMeadTest, MyTypeList);
 TYPED_TEST_CASE(CentralDifference, MyTypeList);
+TYPED_TEST_CASE(ProblemInterface, MyTypeList);
+TYPED_TEST_CASE(AutoDiff, MyTypeList);
 
 // only gradient information
 TEST(GradientDescentTest, RosenbrockFarValue)                      { SOLVE_PROBLEM_D(cppoptlib::GradientDescentSolver,RosenbrockValue, 15.0, 8.0, 0.0) }
@@ -168,6 +294,132 @@ TEST(CMAesTest, RosenbrockFarFull)                           { SOLVE_PROBLEM_D(c
 TEST(CMAesTest, RosenbrockNearFull)                          { SOLVE_PROBLEM_D(cppoptlib::CMAesSolver,RosenbrockFull, -1.0, 2.0, 0.0) }
 TEST(CMAesTest, RosenbrockMixFull)                           { SOLVE_PROBLEM_D(cppoptlib::CMAesSolver,RosenbrockFull, -1.2, 100.0, 0.0) }
 
+TEST(LbfgsTest, HistorySize){
+    // the history wraps around many times before convergence
+    for (int m : {1, 3, 25}) {
+        ChainedRosenbrockElements f(20);
+        Eigen::VectorXd x = Eigen::VectorXd::Constant(20, -1.2);
+        LbfgsSolver<ChainedRosenbrockElements> solver;
+        solver.setMemoryBudget(1024);
+        solver.setHistorySize(m);
+        EXPECT_EQ(m, solver.historySize());
+        EXPECT_EQ(m, solver.effectiveHistorySize(20));
+        solver.minimize(f, x);
+        EXPECT_NEAR(0, f(x), PRECISION);
+        EXPECT_LT(m, static_cast<int>(solver.criteria().iterations));
+    }
+}
+
+TEST(LbfgsTest, FloatHistory){
+    ChainedRosenbrockElements f(20);
+    Eigen::VectorXd x = Eigen::VectorXd::Constant(20, -1.2);
+    LbfgsSolver<ChainedRosenbrockElements, float> solver;
+    // room for 7 pairs of 20 floats
+    solver.setMemoryBudget(7 * 2 * 20 * sizeof(float) + 100);
+    EXPECT_EQ(7, solver.effectiveHistorySize(20));
+    EXPECT_EQ(1, solver.effectiveHistorySize(1000));
+    solver.minimize(f, x);
+    EXPECT_NEAR(0, f(x), PRECISION);
+}
+
+TEST(LbfgsTest, VectorFree){
+    // the same iterates as the two-loop recursion on full vectors
+    ChainedRosenbrockElements f(20);
+    const Eigen::VectorXd x0 = Eigen::VectorXd::Constant(20, -1.2);
+    Eigen::VectorXd x = x0, y = x0;
+    Criteria<double> stop = Criteria<double>::defaults();
+    stop.iterations = 12;
+    LbfgsSolver<ChainedRosenbrockElements> reference;
+    VlbfgsSolver<ChainedRosenbrockElements> solver;
+    reference.setHistorySize(5);
+    solver.setHistorySize(5);
+    reference.setStopCriteria(stop);
+    solver.setStopCriteria(stop);
+    reference.minimize(f, x);
+    solver.minimize(f, y);
+    EXPECT_LT((x - y).norm(), 1e-6);
+
+    y = x0;
+    solver.setStopCriteria(Criteria<double>::defaults());
+    solver.minimize(f, y);
+    EXPECT_NEAR(0, f(y), PRECISION);
+}
+
+TEST(LbfgsbTest, BoundedQuadratic){
+    // sum_i (i + 1) (x_i - c_i)^2 / 2 on [0, 1]^D is minimal at c clamped to the box
+    class Quadratic : public BoundedProblem<double> {
+      public:
+        Eigen::VectorXd c, w;
+        explicit Quadratic(int D) : BoundedProblem<double>(Eigen::VectorXd::Zero(D), Eigen::VectorXd::Ones(D)),
+            c(Eigen::VectorXd::LinSpaced(D, -1, 2)), w(Eigen::VectorXd::LinSpaced(D, 1, D)) {}
+        double value(const TVector &x) { return 0.5 * (x - c).cwiseAbs2().dot(w); }
+        void gradient(const TVector &x, TVector &grad) { grad = w.cwiseProduct(x - c); }
+    };
+    const int D = 50;
+    Quadratic f(D);
+    Eigen::VectorXd x = Eigen::VectorXd::Constant(D, 0.5);
+    LbfgsbSolver<Quadratic> solver;
+    // the history wraps around several times
+    solver.setHistorySize(3);
+    solver.minimize(f, x);
+    EXPECT_LT(3, static_cast<int>(solver.criteria().iterations));
+    EXPECT_LT((x - f.c.cwiseMax(0.0).cwiseMin(1.0)).template lpNorm<Eigen::Infinity>(), 1e-4);
+}
+
+TEST(LbfgsbTest, ActiveBoundsAtStart){
+    // a third of the variables start on the lower and a third on the upper bound, with
+    // the steepest descent direction pointing out of the box, they must never move
+    class Quadratic : public BoundedProblem<double> {
+      public:
+        Eigen::VectorXd c, x0;
+        bool moved = false;
+        explicit Quadratic(int D) : BoundedProblem<double>(Eigen::VectorXd::Zero(D), Eigen::VectorXd::Ones(D)),
+            c(D), x0(D) {
+            for (int i = 0; i < D; ++i) {
+                c[i] = (i % 3 == 0) ? -1.0 : ((i % 3 == 1) ? 2.0 : 0.1 * (i % 7));
+                x0[i] = (i % 3 == 0) ? 0.0 : ((i % 3 == 1) ? 1.0 : 0.5);
+            }
+        }
+        double value(const TVector &x) { return 0.5 * (x - c).squaredNorm(); }
+        void gradient(const TVector &x, TVector &grad) { grad = x - c; }
+        bool callback(const Criteria<double> &, const TVector &x) {
+            for (int i = 0; i < x.rows(); ++i)
+                moved = moved || ((i % 3 != 2) && (x[i] != x0[i]));
+            return true;
+        }
+    };
+    const int D = 30;
+    Quadratic f(D);
+    Eigen::VectorXd x = f.x0;
+    Eigen::VectorXd grad;
+    f.gradient(x, grad);
+    for (int i = 0; i < D; i += 3) {
+        EXPECT_LT(0, grad[i]);
+        EXPECT_GT(0, grad[i + 1]);
+    }
+    LbfgsbSolver<Quadratic> solver;
+    solver.minimize(f, x);
+    EXPECT_FALSE(f.moved);
+    for (int i = 0; i < D; ++i) {
+        if (i % 3 == 2)
+            EXPECT_NEAR(f.c[i], x[i], 1e-6);
+        else
+            EXPECT_EQ(f.x0[i], x[i]);
+    }
+}
+
+TEST(LbfgsbTest, EmptyHistory){
+    // a history of zero pairs is clamped to one
+    typedef RosenbrockGradient<double> TProblem;
+    TProblem f;
+    TProblem::TVector x(2);
+    x << -1.2, 1.0;
+    LbfgsbSolver<TProblem> solver;
+    solver.setHistorySize(0);
+    solver.minimize(f, x);
+    EXPECT_NEAR(0, f(x), PRECISION);
+}
+
 
 TYPED_TEST(CentralDifference, Gradient){
     // simple function y <- 3*a-b
@@ -193,6 +445,35 @@ TYPED_TEST(CentralDifference, Gradient){
     }
 }
 
+TYPED_TEST(CentralDifference, ParallelGradient){
+    // y <- sum_i i*x_i^2, evaluated on private clones
+    class Func : public Problem<TypeParam> {
+      public:
+        using typename Problem<TypeParam>::TVector;
+        TVector scratch;
+        TypeParam value(const TVector &x) {
+            scratch = x.cwiseProduct(x);
+            TypeParam sum = 0;
+            for (int i = 0; i < x.rows(); ++i)
+                sum += i * scratch[i];
+            return sum;
+        }
+        std::unique_ptr<Problem<TypeParam>> clone() const {
+            return std::unique_ptr<Problem<TypeParam>>(new Func(*this));
+        }
+    };
+    const int D = 37;
+    typename Func::TVector x0 = Func::TVector::LinSpaced(D, -1, 1);
+    typename Func::TVector serial, parallel;
+
+    Func f;
+    f.finiteGradient(x0, serial, 1);
+    f.setNumThreads(4);
+    f.finiteGradient(x0, parallel, 1);
+    for (int i = 0; i < D; ++i)
+        EXPECT_EQ(serial(i), parallel(i));
+}
+
 TYPED_TEST(CentralDifference, Hessian){
     // simple function y <- 3*a^2-a*b
     class Func : public Problem<TypeParam, 2> {
@@ -224,6 +505,706 @@ TYPED_TEST(CentralDifference, Hessian){
     EXPECT_NEAR(hessian(1,1), 0, PRECISION);
 }
 
+TYPED_TEST(ProblemInterface, ValueAndGradient){
+    RosenbrockGradient<TypeParam> f;
+    typename RosenbrockGradient<TypeParam>::TVector x, grad, expected_grad;
+    x << -1.2, 1.0;
+
+    f.gradient(x, expected_grad);
+    const TypeParam fx = f.valueAndGradient(x, grad);
+    EXPECT_NEAR(fx, f.value(x), PRECISION);
+    EXPECT_NEAR(grad(0), expected_grad(0), PRECISION);
+    EXPECT_NEAR(grad(1), expected_grad(1), PRECISION);
+}
+
+TYPED_TEST(ProblemInterface, ValueBatch){
+    // rosenbrock evaluated for all columns at once
+    class Batched : public RosenbrockValue<TypeParam> {
+      public:
+        using typename RosenbrockValue<TypeParam>::TBatch;
+        using typename RosenbrockValue<TypeParam>::TBatchValues;
+        int batches = 0;
+        void valueBatch(const TBatch &X, TBatchValues &f) {
+            ++batches;
+            const auto t1 = (1 - X.row(0).array());
+            const auto t2 = (X.row(1).array() - X.row(0).array().square());
+            f = (t1.square() + 100 * t2.square()).matrix().transpose();
+        }
+    };
+    Batched f;
+    typename Batched::TBatch X(2, 3);
+    typename Batched::TBatchValues values;
+    X << -1.2, 1.0, 0.5,
+          1.0, 1.0, -0.5;
+    f.RosenbrockValue<TypeParam>::valueBatch(X, values);
+    for (int i = 0; i < 3; ++i)
+        EXPECT_EQ(f.value(X.col(i)), values[i]);
+
+    // finite differences and nelder-mead go through the batch
+    typename Batched::TVector x, grad, expected_grad;
+    x << -1.2, 1.0;
+    // analytic gradient, the step of the differences is coarse in single precision
+    expected_grad << -215.6, -88.0;
+    const TypeParam tolerance = std::is_same<TypeParam, float>::value ? 5e-2 : 1e-4;
+    f.batches = 0;
+    f.gradient(x, grad);
+    EXPECT_EQ(1, f.batches);
+    for (int i = 0; i < 2; ++i)
+        EXPECT_NEAR(expected_grad(i), grad(i), tolerance * std::abs(expected_grad(i)));
+
+    f.batches = 0;
+    NelderMeadSolver<Batched> solver;
+    solver.minimize(f, x);
+    EXPECT_LT(0, f.batches);
+    EXPECT_NEAR(0, f(x), PRECISION);
+}
+
+TYPED_TEST(ProblemInterface, InstrumentedProblem){
+    typedef RosenbrockGradient<TypeParam> TProblem;
+    TProblem f;
+    InstrumentedProblem<TProblem> instrumented(f);
+    typename TProblem::TVector x;
+    x << -1.2, 1.0;
+
+    BfgsSolver<InstrumentedProblem<TProblem>> solver;
+    solver.minimize(instrumented, x);
+    EXPECT_NEAR(0, f(x), PRECISION);
+
+    const EvaluationStatistics &s = solver.evaluations();
+    EXPECT_LT(0u, s.gradient.calls);
+    EXPECT_LT(0u, s.valueAndGradient.calls);
+    EXPECT_EQ(0u, s.hessian.calls);
+    uint64_t histogram = 0;
+    for (uint64_t count : s.gradient.histogram)
+        histogram += count;
+    EXPECT_EQ(s.gradient.calls, histogram);
+    EXPECT_GE(s.seconds(), s.gradient.seconds());
+    EXPECT_EQ(s.gradient.calls, instrumented.statistics().gradient.calls);
+
+    instrumented.resetStatistics();
+    EXPECT_EQ(0u, instrumented.statistics().gradient.calls);
+
+    // plain problems leave the statistics empty
+    BfgsSolver<TProblem> plain;
+    x << -1.2, 1.0;
+    plain.minimize(f, x);
+    EXPECT_EQ(0u, plain.evaluations().gradient.calls);
+}
+
+TYPED_TEST(ProblemInterface, StaticProblem){
+    static_assert(!StaticRosenbrockValue<TypeParam>::hasGradient(), "value only");
+    static_assert(StaticRosenbrockGradient<TypeParam>::hasGradient(), "gradient defined");
+    static_assert(!StaticRosenbrockGradient<TypeParam>::hasHessian(), "hessian not defined");
+
+    StaticRosenbrockValue<TypeParam> f;
+    StaticRosenbrockGradient<TypeParam> g;
+    RosenbrockFull<TypeParam> full;
+    typename RosenbrockFull<TypeParam>::TVector x, grad, expected_grad;
+    typename RosenbrockFull<TypeParam>::THessian hessian, expected_hessian;
+    x << -1.2, 1.0;
+
+    full.gradient(x, expected_grad);
+    full.hessian(x, expected_hessian);
+    // differences of values, coarse in single precision
+    f.gradient(x, grad);
+    for (int i = 0; i < 2; ++i)
+        EXPECT_NEAR(expected_grad(i), grad(i), 5e-2 * std::abs(expected_grad(i)));
+    f.hessian(x, hessian);
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j)
+            EXPECT_NEAR(expected_hessian(i, j), hessian(i, j), 5e-2 * std::abs(expected_hessian(i, j)));
+    }
+    g.hessian(x, hessian);
+    for (int i = 0; i < 2; ++i) {
+        for (int j = 0; j < 2; ++j)
+            EXPECT_NEAR(expected_hessian(i, j), hessian(i, j), 1e-2 * std::abs(expected_hessian(i, j)));
+    }
+
+    BfgsSolver<StaticRosenbrockGradient<TypeParam>> bfgs;
+    bfgs.minimize(g, x);
+    EXPECT_NEAR(0, g(x), PRECISION);
+
+    x << -1.2, 1.0;
+    LbfgsSolver<StaticRosenbrockGradient<TypeParam>> lbfgs;
+    lbfgs.minimize(g, x);
+    EXPECT_NEAR(0, g(x), PRECISION);
+
+    x << -1.2, 1.0;
+    NelderMeadSolver<StaticRosenbrockValue<TypeParam>> nm;
+    nm.minimize(f, x);
+    EXPECT_NEAR(0, f(x), PRECISION);
+}
+
+TEST(ProblemInterface, FiniteSum){
+    // mean of the squared residuals of a linear model, one term per row
+    class Regression : public FiniteSumProblem<double> {
+      public:
+        Eigen::MatrixXd A;
+        Eigen::VectorXd b;
+        TIndex numTerms() const { return A.rows(); }
+        double minibatchValue(const TVector &x, const TIndices &indices) {
+            double sum = 0;
+            for (TIndex i : indices)
+                sum += 0.5 * std::pow(A.row(i).dot(x) - b[i], 2);
+            return sum / indices.size();
+        }
+    };
+    Regression f;
+    f.A = Eigen::MatrixXd::Random(1001, 3);
+    const Eigen::Vector3d truth(1, -2, 0.5);
+    f.b = f.A * truth;
+    f.setBlockSize(100);
+    f.setNumThreads(4);
+
+    Eigen::VectorXd x = Eigen::VectorXd::Zero(3);
+    const double expected = 0.5 * f.b.squaredNorm() / 1001;
+    EXPECT_NEAR(expected, f.value(x), 1e-12);
+    Eigen::VectorXd grad, expected_grad = -f.A.transpose() * f.b / 1001;
+    EXPECT_NEAR(expected, f.valueAndGradient(x, grad), 1e-12);
+    EXPECT_LT((grad - expected_grad).norm(), 1e-6);
+
+    // every epoch visits all terms once, in a new order
+    MinibatchSampler<Regression::TIndex> sampler(f.numTerms(), 64, 7);
+    Regression::TIndices batch, seen, firstOrder = sampler.order();
+    int batches = 0;
+    while (!sampler.next(batch)) {
+        seen.insert(seen.end(), batch.begin(), batch.end());
+        ++batches;
+    }
+    seen.insert(seen.end(), batch.begin(), batch.end());
+    EXPECT_EQ(16, batches + 1);
+    EXPECT_EQ(1, sampler.epoch());
+    EXPECT_EQ(firstOrder, seen);
+    EXPECT_NE(firstOrder, sampler.order());
+    std::sort(seen.begin(), seen.end());
+    for (int i = 0; i < 1001; ++i)
+        EXPECT_EQ(i, seen[i]);
+
+    // stochastic gradient descent over a few epochs
+    while (sampler.epoch() < 20) {
+        sampler.next(batch);
+        f.minibatchGradient(x, batch, grad);
+        x -= 0.5 * grad;
+    }
+    EXPECT_LT((x - truth).norm(), 1e-3);
+}
+
+TEST(ProblemInterface, LeastSquares){
+    const Eigen::VectorXd t = Eigen::VectorXd::LinSpaced(20, 0, 1);
+    const Eigen::VectorXd y = 2 * (-1.5 * t).array().exp();
+    ExponentialFit<double> f(t, y);
+    ForwardDiffLeastSquaresProblem<ExponentialFit, double> g(t, y);
+    f.setNumThreads(2);
+
+    Eigen::VectorXd x(2), grad, expected_grad;
+    x << 1, -1;
+    Eigen::MatrixXd J, expected_J(20, 2), H;
+    expected_J.col(0) = (-t).array().exp();
+    expected_J.col(1) = (-t).array().exp() * t.array();
+    f.jacobian(x, J);
+    EXPECT_LT((J - expected_J).norm(), 1e-8);
+    g.jacobian(x, J);
+    EXPECT_LT((J - expected_J).norm(), 1e-12);
+
+    // gradient J^T r, Gauss-Newton hessian J^T J
+    Eigen::VectorXd r = expected_J.col(0) - y;
+    EXPECT_NEAR(0.5 * r.squaredNorm(), g.valueAndGradient(x, grad), 1e-12);
+    EXPECT_LT((grad - expected_J.transpose() * r).norm(), 1e-12);
+    g.finiteGradient(x, expected_grad, 3);
+    EXPECT_LT((grad - expected_grad).norm(), 1e-6);
+    g.hessian(x, H);
+    EXPECT_LT((H - expected_J.transpose() * expected_J).norm(), 1e-12);
+
+    // Newton's method on the Gauss-Newton hessian
+    NewtonDescentSolver<ForwardDiffLeastSquaresProblem<ExponentialFit, double>> solver;
+    solver.minimize(g, x);
+    EXPECT_NEAR(2, x[0], 1e-4);
+    EXPECT_NEAR(-1.5, x[1], 1e-4);
+}
+
+TEST(ProblemInterface, LinearConstraints){
+    Eigen::VectorXd v(3), x;
+    v << 0.5, 1.5, -1;
+    projectOntoSimplex(v, 1.0, x);
+    EXPECT_DOUBLE_EQ(0, x[0]);
+    EXPECT_DOUBLE_EQ(1, x[1]);
+    EXPECT_DOUBLE_EQ(0, x[2]);
+    v << 0.5, -1.5, 0.2;
+    projectOntoL1Ball(v, 2.0, x);
+    EXPECT_NEAR(0.5 - 0.2 / 3, x[0], 1e-15);
+    EXPECT_NEAR(-1.5 + 0.2 / 3, x[1], 1e-15);
+    EXPECT_NEAR(0.2 - 0.2 / 3, x[2], 1e-15);
+    projectOntoL1Ball(v, 3.0, x);
+    EXPECT_EQ(v, x);
+
+    // distance to c, the minimiser is the projection of c
+    class Distance : public LinearlyConstrainedProblem<double> {
+      public:
+        Eigen::VectorXd c;
+        explicit Distance(int D) : LinearlyConstrainedProblem<double>(D) {}
+        double value(const TVector &x) { return 0.5 * (x - c).squaredNorm(); }
+        void gradient(const TVector &x, TVector &grad) { grad = x - c; }
+    };
+    const int D = 50;
+    Distance f(D);
+    f.c = Eigen::VectorXd::LinSpaced(D, -1, 1);
+    Eigen::VectorXd expected;
+    projectOntoSimplex(f.c, 1.0, expected);
+
+    // the same simplex as general polyhedron goes through alternating projections
+    f.setEqualities(Eigen::MatrixXd::Ones(1, D), Eigen::VectorXd::Ones(1));
+    f.setLowerBound(Eigen::VectorXd::Zero(D));
+    x = f.c;
+    f.project(x);
+    EXPECT_LT((x - expected).norm(), 1e-8);
+    EXPECT_LT(f.constraintViolation(x), 1e-8);
+
+    f.setSimplexConstraint(D);
+    x = Eigen::VectorXd::Zero(D);
+    ProjectedGradientSolver<Distance> solver;
+    solver.minimize(f, x);
+    EXPECT_LT((x - expected).norm(), 1e-6);
+
+    // half of the simplex is cut off by x_0 + ... + x_{D/2} >= 0.5
+    f.setEqualities(Eigen::MatrixXd::Ones(1, D), Eigen::VectorXd::Ones(1));
+    Eigen::MatrixXd A = Eigen::MatrixXd::Zero(1, D);
+    A.leftCols(D / 2).setConstant(-1);
+    f.setInequalities(A, Eigen::VectorXd::Constant(1, -0.5));
+    x = Eigen::VectorXd::Zero(D);
+    solver.minimize(f, x);
+    EXPECT_LT(f.constraintViolation(x), 1e-8);
+    EXPECT_NEAR(0.5, x.head(D / 2).sum(), 1e-6);
+}
+
+TYPED_TEST(ProblemInterface, CachedProblem){
+    typedef RosenbrockGradient<TypeParam> TProblem;
+    TProblem f;
+    CachedProblem<TProblem> cached(f, 2);
+    typename TProblem::TVector x, grad;
+    x << -1.2, 1.0;
+
+    const TypeParam fx = cached.value(x);
+    EXPECT_EQ(0u, cached.hits());
+    EXPECT_EQ(1u, cached.misses());
+    EXPECT_EQ(fx, cached.valueAndGradient(x, grad));
+    EXPECT_EQ(fx, cached.value(x));
+    EXPECT_EQ(1u, cached.hits());
+    EXPECT_EQ(2u, cached.misses());
+
+    // the least recently used point is dropped once the cache is full
+    typename TProblem::TVector y = x, z = x;
+    y(0) += 1;
+    z(0) += 2;
+    cached.value(y);
+    cached.value(z);
+    cached.value(x);
+    EXPECT_EQ(1u, cached.hits());
+    EXPECT_EQ(5u, cached.misses());
+
+    LbfgsbSolver<CachedProblem<TProblem>> solver;
+    solver.minimize(cached, x);
+    EXPECT_NEAR(0, f(x), PRECISION);
+}
+
+TYPED_TEST(CentralDifference, HessianEvaluations){
+    // y <- sum_i x_i^2 + x_0*x_i
+    class Func : public Problem<TypeParam> {
+      public:
+        using typename Problem<TypeParam>::TVector;
+        int evaluations = 0;
+        TypeParam value(const TVector &x) {
+            ++evaluations;
+            return x.squaredNorm() + x[0] * x.sum();
+        }
+    };
+    const int D = 5;
+    typename Func::TVector x0 = Func::TVector::Zero(D);
+    typename Func::THessian hessian;
+
+    Func f;
+    f.finiteHessian(x0, hessian);
+    EXPECT_EQ(1 + D + D * (D + 1) / 2, f.evaluations);
+    for (int i = 0; i < D; ++i) {
+        for (int j = 0; j < D; ++j) {
+            const TypeParam expected = (i == j ? 2 : 0) + (i == 0 ? 1 : 0) + (j == 0 ? 1 : 0);
+            EXPECT_NEAR(expected, hessian(i, j), PRECISION);
+        }
+    }
+}
+
+TYPED_TEST(CentralDifference, HessianFromGradient){
+    RosenbrockValue<TypeParam> value_only;
+    RosenbrockGradient<TypeParam> with_gradient;
+    RosenbrockFull<TypeParam> full;
+    typename RosenbrockFull<TypeParam>::TVector x0;
+    x0 << -1.2, 1.0;
+    typename RosenbrockFull<TypeParam>::THessian expected, hessian;
+    full.hessian(x0, expected);
+
+    EXPECT_FALSE(value_only.hasAnalyticGradient());
+    EXPECT_TRUE(with_gradient.hasAnalyticGradient());
+    // wrappers answer for the wrapped problem
+    EXPECT_FALSE(CachedProblem<RosenbrockValue<TypeParam>>(value_only).hasAnalyticGradient());
+    EXPECT_TRUE(CachedProblem<RosenbrockGradient<TypeParam>>(with_gradient).hasAnalyticGradient());
+    EXPECT_FALSE(InstrumentedProblem<RosenbrockValue<TypeParam>>(value_only).hasAnalyticGradient());
+    EXPECT_TRUE(InstrumentedProblem<RosenbrockGradient<TypeParam>>(with_gradient).hasAnalyticGradient());
+
+    // picks gradient differences automatically
+    with_gradient.hessian(x0, hessian);
+    for (int accuracy = 0; accuracy < 2; ++accuracy) {
+        if (accuracy > 0)
+            with_gradient.finiteHessianFromGradient(x0, hessian, accuracy);
+        for (int i = 0; i < 2; ++i) {
+            for (int j = 0; j < 2; ++j) {
+                EXPECT_NEAR(expected(i, j), hessian(i, j), 1e-2 * std::abs(expected(i, j)));
+                EXPECT_EQ(hessian(i, j), hessian(j, i));
+            }
+        }
+    }
+}
+
+TEST(CentralDifference, SparseColouring){
+    typedef ChainedRosenbrock<double> TProblem;
+    const int D = 20;
+    TProblem f;
+    std::vector<std::vector<TProblem::TIndex>> elements;
+    Eigen::SparseMatrix<double> pattern(D, D);
+    for (int i = 0; i < D - 1; ++i) {
+        elements.push_back({i, i + 1});
+        pattern.insert(i + 1, i) = 1;
+    }
+    f.setElementVariables(D, elements);
+    f.setHessianSparsity(pattern);
+    EXPECT_EQ(2, f.numElementColours());
+    EXPECT_EQ(3, f.numHessianColours());
+
+    TProblem::TVector x = TProblem::TVector::LinSpaced(D, -1.2, 1.0);
+    TProblem::TVector grad, expected_grad;
+    f.analyticGradient(x, expected_grad);
+    f.gradient(x, grad);
+    EXPECT_EQ(1 + 2, f.elementEvaluations);
+    for (int i = 0; i < D; ++i)
+        EXPECT_NEAR(expected_grad(i), grad(i), 1e-4 * std::max(1.0, std::abs(expected_grad(i))));
+
+    TProblem::THessian expected_hessian, hessian;
+    f.analyticHessian(x, expected_hessian);
+    Eigen::SparseMatrix<double> sparse;
+    f.sparseHessian(x, sparse);
+    EXPECT_EQ(3 * D - 2, sparse.nonZeros());
+    hessian = sparse.toDense();
+    for (int i = 0; i < D; ++i) {
+        for (int j = 0; j < D; ++j)
+            EXPECT_NEAR(expected_hessian(i, j), hessian(i, j), 1e-3 * std::max(1.0, std::abs(expected_hessian(i, j))));
+    }
+}
+
+TEST(CentralDifference, ConstrainedProblem){
+    // x_i^2 - x_{i+1} = 0 for all but the last pair, x_0 + x_1 <= 1
+    class Chained : public ConstrainedProblem<double> {
+      public:
+        explicit Chained(int D) : ConstrainedProblem<double>(D) { setNumConstraints(D - 2, 1); }
+        std::unique_ptr<Problem<double>> clone() const {
+            return std::unique_ptr<Problem<double>>(new Chained(*this));
+        }
+        double value(const TVector &x) { return x.squaredNorm(); }
+        void constraints(const TVector &x, TConstraints &c) {
+            const int D = x.rows();
+            c.resize(D - 1);
+            for (int i = 0; i < D - 2; ++i)
+                c[i] = x[i] * x[i] - x[i + 1];
+            c[D - 2] = x[0] + x[1] - 1;
+        }
+    };
+    const int D = 20;
+    Chained f(D);
+    f.setNumThreads(3);
+    Eigen::SparseMatrix<double> pattern(D - 1, D);
+    for (int i = 0; i < D - 2; ++i) {
+        pattern.insert(i, i) = 1;
+        pattern.insert(i, i + 1) = 1;
+    }
+    pattern.insert(D - 2, 0) = 1;
+    pattern.insert(D - 2, 1) = 1;
+
+    Eigen::VectorXd x = Eigen::VectorXd::LinSpaced(D, -1, 1), c;
+    Eigen::MatrixXd expected = Eigen::MatrixXd::Zero(D - 1, D), J;
+    for (int i = 0; i < D - 2; ++i) {
+        expected(i, i) = 2 * x[i];
+        expected(i, i + 1) = -1;
+    }
+    expected(D - 2, 0) = expected(D - 2, 1) = 1;
+
+    // dense differences, then the same with one difference per colour
+    f.constraintJacobian(x, J);
+    EXPECT_LT((J - expected).norm(), 1e-8);
+    f.setConstraintJacobianSparsity(pattern);
+    EXPECT_EQ(2, f.numConstraintJacobianColours());
+    Eigen::SparseMatrix<double> sparse;
+    Eigen::VectorXd grad;
+    EXPECT_DOUBLE_EQ(x.squaredNorm(), f.evaluateSparse(x, grad, c, sparse));
+    EXPECT_EQ(2 * D - 2, sparse.nonZeros());
+    EXPECT_LT((Eigen::MatrixXd(sparse) - expected).norm(), 1e-8);
+    EXPECT_LT((grad - 2 * x).norm(), 1e-6);
+
+    // the inequality holds, only the equalities are violated
+    EXPECT_DOUBLE_EQ(c.head(D - 2).cwiseAbs().maxCoeff(), f.constraintViolation(c));
+    x.setZero();
+    f.constraints(x, c);
+    EXPECT_EQ(0, f.constraintViolation(c));
+}
+
+TEST(CentralDifference, HessianVectorProduct){
+    typedef ChainedRosenbrock<double> TProblem;
+    const int D = 6;
+    TProblem f;
+    ForwardDiffProblem<ChainedRosenbrock, double, 4> g;
+    TProblem::TVector x = TProblem::TVector::LinSpaced(D, -1.2, 1.0);
+    TProblem::TVector v = TProblem::TVector::LinSpaced(D, 1.0, -0.5);
+    TProblem::TVector grad, Hv, expected_Hv;
+    TProblem::THessian hessian;
+
+    f.analyticHessian(x, hessian);
+    expected_Hv = hessian * v;
+
+    // finite differences of finite difference gradients
+    f.hessianVectorProduct(x, v, Hv);
+    for (int i = 0; i < D; ++i)
+        EXPECT_NEAR(expected_Hv(i), Hv(i), 1e-3 * std::max(1.0, std::abs(expected_Hv(i))));
+
+    // a single exact gradient evaluation on top of a known gradient
+    f.analyticGradient(x, grad);
+    g.finiteHessianVectorProduct(x, grad, v, Hv);
+    for (int i = 0; i < D; ++i)
+        EXPECT_NEAR(expected_Hv(i), Hv(i), 1e-3 * std::max(1.0, std::abs(expected_Hv(i))));
+
+    // exact with dual numbers
+    g.hessianVectorProduct(x, v, Hv);
+    for (int i = 0; i < D; ++i)
+        EXPECT_NEAR(expected_Hv(i), Hv(i), 1e-10 * std::max(1.0, std::abs(expected_Hv(i))));
+}
+
+TEST(CentralDifference, DirectionalChecks){
+    typedef ForwardDiffProblem<ChainedRosenbrock, double> TProblem;
+    const int D = 20;
+    TProblem f;
+    TProblem::TVector x = TProblem::TVector::LinSpaced(D, -1.2, 1.0);
+
+    std::vector<double> errors;
+    EXPECT_GT(1e-6, f.directionalGradientError(x, 5, 3, &errors));
+    EXPECT_EQ(5u, errors.size());
+    EXPECT_GT(1e-6, f.directionalHessianError(x, 5, 3, &errors));
+    EXPECT_EQ(5u, errors.size());
+
+    // a single wrong component is seen by random directions
+    struct WrongGradient : public ChainedRosenbrock<double> {
+        void gradient(const TVector &x, TVector &grad) {
+            analyticGradient(x, grad);
+            grad[3] += 1;
+        }
+    } wrong;
+    EXPECT_LT(1e-3, wrong.directionalGradientError(x));
+
+    // a wrong hessian is caught although the default product differences the gradient
+    struct WrongHessian : public ChainedRosenbrock<double> {
+        void gradient(const TVector &x, TVector &grad) { analyticGradient(x, grad); }
+        bool hasAnalyticGradient() const { return true; }
+        void hessian(const TVector &x, THessian &hessian) {
+            analyticHessian(x, hessian);
+            hessian(3, 3) += 10;
+        }
+    } wrongHessian;
+    EXPECT_LT(1e-3, wrongHessian.directionalHessianError(x, 4, 3, nullptr, 0, true));
+    // without the opt-in only the matrix-free product is checked
+    EXPECT_GT(1e-5, wrongHessian.directionalHessianError(x));
+    struct RightHessian : public ChainedRosenbrock<double> {
+        void gradient(const TVector &x, TVector &grad) { analyticGradient(x, grad); }
+        bool hasAnalyticGradient() const { return true; }
+        void hessian(const TVector &x, THessian &hessian) { analyticHessian(x, hessian); }
+    } rightHessian;
+    EXPECT_GT(1e-5, rightHessian.directionalHessianError(x, 4, 3, nullptr, 0, true));
+}
+
+TEST(CentralDifference, PartiallySeparable){
+    const int D = 50;
+    ChainedRosenbrockElements f(D);
+    ChainedRosenbrock<double> reference;
+    ChainedRosenbrockElements::TVector x(D), grad, expected_grad, parallel_grad;
+    for (int i = 0; i < D; ++i)
+        x[i] = (i % 2 == 0) ? -1.2 : 1.0;
+    ChainedRosenbrockElements::THessian hessian, expected_hessian;
+
+    EXPECT_NEAR(reference.value(x), f.value(x), 1e-10 * reference.value(x));
+    reference.analyticGradient(x, expected_grad);
+    f.gradient(x, grad);
+    for (int i = 0; i < D; ++i)
+        EXPECT_NEAR(expected_grad(i), grad(i), 1e-6 * std::max(1.0, std::abs(expected_grad(i))));
+    f.setNumThreads(4);
+    f.gradient(x, parallel_grad);
+    for (int i = 0; i < D; ++i)
+        EXPECT_EQ(grad(i), parallel_grad(i));
+    // one pass for both, the element gradients are kept for the same point only
+    EXPECT_EQ(f.value(x), f.valueAndGradient(x, parallel_grad));
+    std::vector<ChainedRosenbrockElements::TElementVector> grads;
+    EXPECT_FALSE(f.takeElementGradients(-x, grads));
+    EXPECT_TRUE(f.takeElementGradients(x, grads));
+    EXPECT_FALSE(f.takeElementGradients(x, grads));
+    f.assembleGradient(grads, parallel_grad);
+    for (int i = 0; i < D; ++i)
+        EXPECT_EQ(grad(i), parallel_grad(i));
+
+    reference.analyticHessian(x, expected_hessian);
+    f.hessian(x, hessian);
+    for (int i = 0; i < D; ++i) {
+        for (int j = 0; j < D; ++j)
+            EXPECT_NEAR(expected_hessian(i, j), hessian(i, j), 1e-4 * std::max(1.0, std::abs(expected_hessian(i, j))));
+    }
+
+    PartitionedSr1Solver<ChainedRosenbrockElements> solver;
+    solver.minimize(f, x);
+    EXPECT_NEAR(0, f(x), PRECISION);
+
+    // the last variable belongs to no element, its row of the hessian stays empty
+    class Uncovered : public ChainedRosenbrockElements {
+      public:
+        explicit Uncovered(int D) : ChainedRosenbrockElements(D - 1) {
+            std::vector<std::vector<Eigen::DenseIndex>> elements;
+            for (int i = 0; i < D - 2; ++i)
+                elements.push_back({i, i + 1});
+            setElements(D, elements);
+        }
+    };
+    Uncovered g(10);
+    Uncovered::TVector y = Uncovered::TVector::Constant(10, -1.2);
+    Uncovered::TSparseHessian pattern;
+    g.sparseHessian(y, pattern);
+    EXPECT_EQ(10 + 2 * 8, pattern.nonZeros());
+    PartitionedSr1Solver<Uncovered> uncoveredSolver;
+    uncoveredSolver.minimize(g, y);
+    EXPECT_NEAR(0, g(y), PRECISION);
+    EXPECT_EQ(-1.2, y[9]);
+}
+
+TYPED_TEST(AutoDiff, ForwardRosenbrock){
+    typedef ForwardDiffProblem<RosenbrockValue, TypeParam> TProblem;
+    TProblem f;
+    RosenbrockFull<TypeParam> full;
+    typename TProblem::TVector x, grad, expected_grad;
+    typename TProblem::THessian hessian, expected_hessian;
+    x << -1.2, 1.0;
+
+    full.gradient(x, expected_grad);
+    full.hessian(x, expected_hessian);
+    EXPECT_EQ(full.value(x), f.valueAndGradient(x, grad));
+    f.hessian(x, hessian);
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_NEAR(expected_grad(i), grad(i), 1e-5 * std::abs(expected_grad(i)));
+        for (int j = 0; j < 2; ++j)
+            EXPECT_NEAR(expected_hessian(i, j), hessian(i, j), 1e-5 * std::abs(expected_hessian(i, j)));
+    }
+
+    BfgsSolver<TProblem> solver;
+    solver.minimize(f, x);
+    EXPECT_NEAR(0, f(x), PRECISION);
+}
+
+TEST(AutoDiff, ForwardChainedRosenbrock){
+    // 7 variables in lanes of 3 cover partially filled blocks
+    typedef ForwardDiffProblem<ChainedRosenbrock, double, 3> TProblem;
+    const int D = 7;
+    TProblem f;
+    TProblem::TVector x = TProblem::TVector::LinSpaced(D, -1.2, 1.0);
+    TProblem::TVector grad, expected_grad;
+    TProblem::THessian hessian, expected_hessian;
+
+    f.analyticGradient(x, expected_grad);
+    f.analyticHessian(x, expected_hessian);
+    f.gradient(x, grad);
+    f.hessian(x, hessian);
+    for (int i = 0; i < D; ++i) {
+        EXPECT_NEAR(expected_grad(i), grad(i), 1e-10 * std::max(1.0, std::abs(expected_grad(i))));
+        for (int j = 0; j < D; ++j)
+            EXPECT_NEAR(expected_hessian(i, j), hessian(i, j), 1e-10 * std::max(1.0, std::abs(expected_hessian(i, j))));
+    }
+}
+
+TYPED_TEST(AutoDiff, ReverseRosenbrock){
+    typedef ReverseDiffProblem<RosenbrockValue, TypeParam> TProblem;
+    TProblem f;
+    RosenbrockFull<TypeParam> full;
+    typename TProblem::TVector x, grad, expected_grad;
+    x << -1.2, 1.0;
+
+    full.gradient(x, expected_grad);
+    EXPECT_EQ(full.value(x), f.valueAndGradient(x, grad));
+    for (int i = 0; i < 2; ++i)
+        EXPECT_NEAR(expected_grad(i), grad(i), 1e-5 * std::abs(expected_grad(i)));
+
+    BfgsSolver<TProblem> solver;
+    solver.minimize(f, x);
+    EXPECT_NEAR(0, f(x), PRECISION);
+}
+
+TEST(AutoDiff, ReverseChainedRosenbrock){
+    typedef ReverseDiffProblem<ChainedRosenbrock, double> TProblem;
+    const int D = 50;
+    TProblem f;
+    TProblem::TVector x = TProblem::TVector::LinSpaced(D, -1.2, 1.0);
+    TProblem::TVector grad, expected_grad;
+
+    f.analyticGradient(x, expected_grad);
+    f.gradient(x, grad);
+    for (int i = 0; i < D; ++i)
+        EXPECT_NEAR(expected_grad(i), grad(i), 1e-10 * std::max(1.0, std::abs(expected_grad(i))));
+
+    // the tape is reused, a second gradient records the same nodes into the same memory
+    const Eigen::DenseIndex nodes = f.tape().size();
+    const Eigen::DenseIndex capacity = f.tape().capacity();
+    x.array() += 0.1;
+    f.analyticGradient(x, expected_grad);
+    f.gradient(x, grad);
+    EXPECT_EQ(nodes, f.tape().size());
+    EXPECT_EQ(capacity, f.tape().capacity());
+    for (int i = 0; i < D; ++i)
+        EXPECT_NEAR(expected_grad(i), grad(i), 1e-10 * std::max(1.0, std::abs(expected_grad(i))));
+}
+
+TYPED_TEST(AutoDiff, ComplexStepRosenbrock){
+    typedef ComplexStepProblem<RosenbrockValue, TypeParam> TProblem;
+    TProblem f;
+    RosenbrockFull<TypeParam> full;
+    typename TProblem::TVector x, grad, expected_grad;
+    x << -1.2, 1.0;
+
+    full.gradient(x, expected_grad);
+    EXPECT_NEAR(full.value(x), f.valueAndGradient(x, grad), 1e-5 * full.value(x));
+    for (int i = 0; i < 2; ++i)
+        EXPECT_NEAR(expected_grad(i), grad(i), 1e-5 * std::abs(expected_grad(i)));
+
+    BfgsSolver<TProblem> solver;
+    solver.minimize(f, x);
+    EXPECT_NEAR(0, f(x), PRECISION);
+}
+
+TEST(AutoDiff, ComplexStepChainedRosenbrock){
+    typedef ComplexStepProblem<ChainedRosenbrock, double> TProblem;
+    const int D = 11;
+    TProblem f;
+    TProblem::TVector x = TProblem::TVector::LinSpaced(D, -1.2, 1.0);
+    TProblem::TVector grad, expected_grad;
+
+    f.analyticGradient(x, expected_grad);
+    f.gradient(x, grad);
+    EXPECT_EQ(D, f.complexProblem().elementEvaluations);
+    for (int i = 0; i < D; ++i)
+        EXPECT_NEAR(expected_grad(i), grad(i), 1e-12 * std::max(1.0, std::abs(expected_grad(i))));
+
+    TProblem::TVector parallel_grad;
+    f.setNumThreads(3);
+    f.gradient(x, parallel_grad);
+    for (int i = 0; i < D; ++i)
+        EXPECT_EQ(grad(i), parallel_grad(i));
+}
+
 int main (int argc, char **argv)
 {
   ::testing::InitGoogleTest(&argc, argv);